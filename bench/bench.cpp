@@ -0,0 +1,271 @@
+/**
+ * Native micro-benchmark of the wallet.sx balance engine.
+ *
+ * Compiles wallet.sx.cpp against the host-side CDT stand-ins in `bench/eosio` (in-memory
+ * multi_index, mock intrinsics, captured inline actions) and reports per-operation cost.
+ *
+ * usage: ./scripts/bench_native.sh [iterations=1000000] [users=1000] [symbols=1]
+ */
+#include "../wallet.sx.cpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <new>
+
+using namespace eosio;
+
+namespace {
+   uint64_t allocations = 0;
+   uint64_t own_allocations = 0;            // outside CDT library code (table row cache, action packing)
+}
+
+void* operator new( size_t size )
+{
+   if ( host::tracking() ) {
+      allocations++;
+      if ( !host::library_depth() ) own_allocations++;
+   }
+   if ( void* ptr = std::malloc( size ? size : 1 ) ) return ptr;
+   throw std::bad_alloc();
+}
+
+void operator delete( void* ptr ) noexcept { std::free( ptr ); }
+void operator delete( void* ptr, size_t ) noexcept { std::free( ptr ); }
+
+namespace {
+
+   const name self = "wallet.sx"_n;
+   const name token_contract = "eosio.token"_n;
+
+   struct fixture {
+      vector<name> users;
+      vector<symbol> symbols;
+   };
+
+   name user_name( uint32_t i )
+   {
+      string str = "user";
+      for ( int c = 0; c < 4; c++, i /= 26 ) str += char( 'a' + i % 26 );
+      return name{ str };
+   }
+
+   symbol symbol_at( uint32_t i )
+   {
+      string str = "S";
+      for ( int c = 0; c < 3; c++, i /= 26 ) str += char( 'A' + i % 26 );
+      return symbol{ str, 4 };
+   }
+
+   sx::wallet wallet( const name first_receiver, const std::set<name>& auths )
+   {
+      host::untracked guard;
+      host::set_action_context( self, first_receiver, auths );
+      return sx::wallet( self, first_receiver, datastream<const char*>( nullptr, 0 ) );
+   }
+
+   sx::wallet wallet( const name first_receiver, std::initializer_list<name> auths )
+   {
+      host::untracked guard;
+      return wallet( first_receiver, std::set<name>( auths ) );
+   }
+
+   void create_token( const symbol sym )
+   {
+      host::set_action_context( token_contract, token_contract, {} );
+      token::stats _stats( token_contract, sym.code().raw() );
+      _stats.emplace( token_contract, [&]( auto& row ) {
+         row.supply = asset{ 0, sym };
+         row.max_supply = asset{ asset::max_amount, sym };
+         row.issuer = token_contract;
+      });
+   }
+
+   fixture setup( const uint32_t users, const uint32_t symbols )
+   {
+      host::reset_all();
+      fixture f;
+      auto& accounts = host::state().accounts;
+      accounts = { self, token_contract };
+      for ( uint32_t i = 0; i < users; i++ ) {
+         f.users.push_back( user_name( i ) );
+         accounts.insert( f.users.back() );
+      }
+      for ( uint32_t i = 0; i < symbols; i++ ) {
+         f.symbols.push_back( symbol_at( i ) );
+         create_token( f.symbols.back() );
+      }
+      // every user holds every symbol (token & wallet balances opened first for `strict_open` builds)
+      for ( const name user : f.users ) {
+         for ( const symbol sym : f.symbols ) {
+            host::set_action_context( token_contract, token_contract, {} );
+            token::accounts( token_contract, user.value ).emplace( user, [&]( auto& row ) { row.balance = asset{ 0, sym }; });
+            wallet( self, { user } ).open( user, token_contract, sym.code(), user );
+            wallet( token_contract, { user } ).on_transfer( user, self, asset{ 1000000000, sym }, "" );
+         }
+      }
+      host::state().actions.clear();
+      return f;
+   }
+
+   // returns contract-owned allocations per operation
+   double report( const char* label, const uint64_t ops, const std::function<void( uint64_t )>& op )
+   {
+      host::counters() = {};
+      allocations = 0;
+      own_allocations = 0;
+
+      const auto start = std::chrono::steady_clock::now();
+      for ( uint64_t i = 0; i < ops; i++ ) {
+         op( i );
+         if ( ( i & 1023 ) == 1023 ) {
+            host::untracked guard;
+            host::state().actions.clear();
+         }
+      }
+      const auto end = std::chrono::steady_clock::now();
+
+      const auto& c = host::counters();
+      const double n = double( ops );
+      printf( "%-12s %10lu %10.1f %10.2f %8.2f %10.1f %10.1f %8.2f %8.2f %8.2f\n",
+              label, ops,
+              std::chrono::duration<double, std::nano>( end - start ).count() / n,
+              double( allocations ) / n,
+              double( own_allocations ) / n,
+              double( c.bytes_read ) / n,
+              double( c.bytes_written ) / n,
+              double( c.db_reads ) / n,
+              double( c.db_writes ) / n,
+              double( c.inline_actions ) / n );
+      return double( own_allocations ) / n;
+   }
+}
+
+int main( int argc, char** argv )
+{
+   const uint64_t iterations = argc > 1 ? std::strtoull( argv[1], nullptr, 10 ) : 1000000;
+   const uint32_t users = argc > 2 ? std::strtoul( argv[2], nullptr, 10 ) : 1000;
+   const uint32_t symbols = argc > 3 ? std::strtoul( argv[3], nullptr, 10 ) : 1;
+
+   fixture f = setup( users, symbols );
+   const auto user = [&]( uint64_t i ) { return f.users[ i % f.users.size() ]; };
+   const auto sym = [&]( uint64_t i ) { return f.symbols[ ( i / f.users.size() ) % f.symbols.size() ]; };
+
+   // routing memos `<account>:<tags>` crediting the next user
+   vector<string> memos;
+   for ( uint32_t i = 0; i < users; i++ ) memos.push_back( user_name( ( i + 1 ) % users ).to_string() + ":ref" );
+
+   printf( "iterations: %lu, users: %u, symbols: %u\n\n", iterations, users, symbols );
+   printf( "%-12s %10s %10s %10s %8s %10s %10s %8s %8s %8s\n",
+           "operation", "ops", "ns/op", "allocs/op", "own/op", "read B/op", "write B/op", "reads", "writes", "inline" );
+
+   // single balance actions must not allocate outside CDT library code on their success path,
+   // except to grow the compact `amounts` row when a new balance entry is inserted
+   struct gate { const char* label; double allocs; double expected; };
+   vector<gate> own;
+   const auto single = [&]( const char* label, const uint64_t ops, const std::function<void( uint64_t )>& op, const double expected = 0 ) {
+      own.push_back( { label, report( label, ops, op ), expected } );
+   };
+
+   single( "deposit", iterations, [&]( uint64_t i ) {
+      wallet( token_contract, { user( i ) } ).on_transfer( user( i ), self, asset{ 1, sym( i ) }, "" );
+   });
+
+   single( "deposit memo", iterations, [&]( uint64_t i ) {
+      wallet( token_contract, { user( i ) } ).on_transfer( user( i ), self, asset{ 1, sym( i ) }, memos[ i % memos.size() ] );
+   });
+
+   single( "withdraw", iterations, [&]( uint64_t i ) {
+      wallet( self, { user( i ) } ).withdraw( user( i ), token_contract, asset{ 1, sym( i ) } );
+   });
+
+   single( "move", iterations, [&]( uint64_t i ) {
+      wallet( self, { user( i ) } ).move( user( i ), user( i + 1 ), token_contract, asset{ 1, sym( i ) }, "" );
+   });
+
+   // 200-leg settlements, every leg moves between two of 50 users across all symbols (netting allocates)
+   const uint64_t legs = 200;
+   report( "settle 200", iterations / legs, [&]( uint64_t i ) {
+      host::untracked guard;
+      vector<sx::wallet::movement> movements;
+      std::set<name> auths;
+      for ( uint64_t k = 0; k < legs; k++ ) {
+         const name from = user( i * 50 + k % 50 );
+         const name to = user( i * 50 + ( k * 7 + 1 ) % 50 );
+         if ( from == to ) continue;
+         movements.push_back( { from, to, token_contract, asset{ int64_t( 1 + k % 3 ), f.symbols[ k % f.symbols.size() ] } } );
+         auths.insert( from );
+      }
+      host::tracking() = true;
+      wallet( self, auths ).settle( movements );
+   });
+
+   // batched actions allocate their grouping containers once per action (not per balance row):
+   // `withdrawbatch` a contract & a symbol map node and the quantities of the contract (and its `stats` counters),
+   // `movemany` a debit map node and the debited quantities (arguments are moved in, as unpacked by the dispatcher)
+   single( "withdrawbatch", iterations, [&]( uint64_t i ) {
+      host::untracked guard;
+      vector<extended_asset> quantities = { { asset{ 1, sym( i ) }, token_contract }, { asset{ 1, sym( i ) }, token_contract } };
+      host::tracking() = true;
+      wallet( self, { user( i ) } ).withdrawbatch( user( i ), std::move( quantities ) );
+   }, sx::policy::stats ? 4 : 3 );
+
+   single( "movemany", iterations, [&]( uint64_t i ) {
+      host::untracked guard;
+      vector<sx::wallet::recipient> recipients = { { user( i + 1 ), asset{ 1, sym( i ) } }, { user( i + 2 ), asset{ 1, sym( i ) } } };
+      host::tracking() = true;
+      wallet( self, { user( i ) } ).movemany( user( i ), token_contract, std::move( recipients ), "" );
+   }, 2 );
+
+   // queued withdrawals & maintenance actions are allocation-free like single balance actions
+   single( "qwithdraw", iterations, [&]( uint64_t i ) {
+      wallet( self, { user( i ) } ).qwithdraw( user( i ), token_contract, asset{ 1, sym( i ) } );
+   });
+
+   single( "flush", f.users.size(), [&]( uint64_t i ) {
+      wallet( self, {} ).flush( user( i ), f.symbols.size() );
+   });
+
+   single( "sweep 10", iterations / 10, [&]( uint64_t i ) {
+      wallet( self, {} ).sweep( 10 );
+   });
+
+   // legacy rows of another token contract, one account migrated per call (allocates the entries of its new `amounts` row)
+   const name legacy_contract = "token.old"_n;
+   {
+      host::untracked guard;
+      for ( const name user : f.users ) {
+         host::set_action_context( self, self, {} );
+         sx::wallet::balances( self, user.value ).emplace( self, [&]( auto& row ) {
+            row.contract = legacy_contract;
+            for ( const symbol sym : f.symbols ) row.balances[ sym.code() ] = asset{ 1, sym };
+         });
+      }
+      wallet( self, { self } ).queuemigrate( f.users );
+   }
+   single( "migrate", f.users.size(), [&]( uint64_t i ) {
+      wallet( self, {} ).migrate( 1 );
+   }, 1 );
+
+   // open & close symbols the users never held, so every open creates and every close erases a row
+   const uint64_t churn = iterations / 2;
+   const auto fresh = [&]( uint64_t i ) { return symbol_at( symbols + i / f.users.size() ).code(); };
+   for ( uint64_t i = 0; i < churn; i += f.users.size() ) create_token( symbol{ fresh( i ), 4 } );
+
+   single( "open", churn, [&]( uint64_t i ) {
+      wallet( self, { user( i ) } ).open( user( i ), token_contract, fresh( i ), user( i ) );
+   }, 1 );
+   single( "close", churn, [&]( uint64_t i ) {
+      wallet( self, { user( i ) } ).close( user( i ), token_contract, fresh( i ) );
+   });
+
+   bool allocation_free = true;
+   for ( const gate& g : own ) {
+      if ( g.allocs <= g.expected ) continue;
+      printf( "\n%s: %.2f contract allocations per operation (expected %.0f)", g.label, g.allocs, g.expected );
+      allocation_free = false;
+   }
+   printf( allocation_free ? "\nsuccess path of balance actions is allocation-free (besides growing `amounts` rows & batch grouping)\n" : "\n" );
+   return allocation_free ? 0 : 1;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "datastream.hpp"
+#include "host.hpp"
+
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace eosio {
+
+   /**
+    * Host-side stand-in for `eosio::action`; `send()` appends to the captured inline action log.
+    */
+   struct action {
+      name account;
+      name name_;
+      std::vector<permission_level> authorization;
+      std::vector<char> data;
+
+      action() = default;
+
+      template <typename T>
+      action( const std::vector<permission_level>& auth, name a, name n, const T& value )
+         : account( a ), name_( n )
+      {
+         host::library guard;
+         authorization = auth;
+         data = pack( value );
+      }
+
+      template <typename T>
+      action( const permission_level& auth, name a, name n, const T& value )
+         : action( std::vector<permission_level>{ auth }, a, n, value ) {}
+
+      void send() const
+      {
+         host::counters().inline_actions++;
+         host::untracked guard;
+         host::state().actions.push_back( host::inline_action{ account, name_, authorization, data } );
+      }
+   };
+
+   namespace detail {
+      template <typename T>
+      struct member_function_args;
+
+      template <typename C, typename R, typename... Args>
+      struct member_function_args<R ( C::* )( Args... )> {
+         using type = std::tuple<std::remove_cv_t<std::remove_reference_t<Args>>...>;
+      };
+
+      template <typename C, typename R, typename... Args>
+      struct member_function_args<R ( C::* )( Args... ) const> {
+         using type = std::tuple<std::remove_cv_t<std::remove_reference_t<Args>>...>;
+      };
+   }
+
+   /**
+    * Host-side stand-in for `eosio::action_wrapper`.
+    */
+   template <name::raw Name, auto Action>
+   struct action_wrapper {
+      using args = typename detail::member_function_args<decltype( Action )>::type;
+
+      template <typename Code>
+      action_wrapper( Code&& code, std::vector<permission_level>&& perms ) : code_name( std::forward<Code>( code ) ), permissions( std::move( perms ) ) {}
+      template <typename Code>
+      action_wrapper( Code&& code, const std::vector<permission_level>& perms ) : code_name( std::forward<Code>( code ) ) { host::library guard; permissions = perms; }
+      template <typename Code>
+      action_wrapper( Code&& code, permission_level&& perm ) : code_name( std::forward<Code>( code ) ) { host::library guard; permissions = { perm }; }
+      template <typename Code>
+      action_wrapper( Code&& code, const permission_level& perm ) : code_name( std::forward<Code>( code ) ) { host::library guard; permissions = { perm }; }
+
+      template <typename... Args>
+      action to_action( Args&&... a ) const
+      {
+         host::library guard;
+         return action( permissions, code_name, name( Name ), args{ std::forward<Args>( a )... } );
+      }
+
+      template <typename... Args>
+      void send( Args&&... a ) const { to_action( std::forward<Args>( a )... ).send(); }
+
+      name code_name;
+      std::vector<permission_level> permissions;
+   };
+}
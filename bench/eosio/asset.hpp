@@ -0,0 +1,92 @@
+#pragma once
+
+#include "check.hpp"
+#include "symbol.hpp"
+
+#include <string>
+
+namespace eosio {
+
+   /**
+    * Host-side stand-in for `eosio::asset`.
+    */
+   struct asset {
+      static constexpr int64_t max_amount = ( 1LL << 62 ) - 1;
+
+      int64_t amount = 0;
+      eosio::symbol symbol;
+
+      asset() = default;
+      asset( int64_t a, eosio::symbol s ) : amount( a ), symbol( s )
+      {
+         check( is_amount_within_range(), "magnitude of asset amount must be less than 2^62" );
+         check( symbol.is_valid(), "invalid symbol name" );
+      }
+
+      bool is_amount_within_range() const { return -max_amount <= amount && amount <= max_amount; }
+      bool is_valid() const { return is_amount_within_range() && symbol.is_valid(); }
+      void set_amount( int64_t a ) { amount = a; check( is_amount_within_range(), "magnitude of asset amount must be less than 2^62" ); }
+
+      asset operator-() const { asset r = *this; r.amount = -r.amount; return r; }
+
+      asset& operator-=( const asset& a )
+      {
+         check( a.symbol == symbol, "attempt to subtract asset with different symbol" );
+         amount -= a.amount;
+         check( -max_amount <= amount, "subtraction underflow" );
+         check( amount <= max_amount, "subtraction overflow" );
+         return *this;
+      }
+
+      asset& operator+=( const asset& a )
+      {
+         check( a.symbol == symbol, "attempt to add asset with different symbol" );
+         amount += a.amount;
+         check( -max_amount <= amount, "addition underflow" );
+         check( amount <= max_amount, "addition overflow" );
+         return *this;
+      }
+
+      friend asset operator+( const asset& a, const asset& b ) { asset r = a; r += b; return r; }
+      friend asset operator-( const asset& a, const asset& b ) { asset r = a; r -= b; return r; }
+
+      friend bool operator==( const asset& a, const asset& b ) { check( a.symbol == b.symbol, "comparison of assets with different symbols is not allowed" ); return a.amount == b.amount; }
+      friend bool operator!=( const asset& a, const asset& b ) { return !( a == b ); }
+      friend bool operator<( const asset& a, const asset& b ) { check( a.symbol == b.symbol, "comparison of assets with different symbols is not allowed" ); return a.amount < b.amount; }
+      friend bool operator<=( const asset& a, const asset& b ) { check( a.symbol == b.symbol, "comparison of assets with different symbols is not allowed" ); return a.amount <= b.amount; }
+      friend bool operator>( const asset& a, const asset& b ) { check( a.symbol == b.symbol, "comparison of assets with different symbols is not allowed" ); return a.amount > b.amount; }
+      friend bool operator>=( const asset& a, const asset& b ) { check( a.symbol == b.symbol, "comparison of assets with different symbols is not allowed" ); return a.amount >= b.amount; }
+
+      std::string to_string() const
+      {
+         const bool negative = amount < 0;
+         const uint64_t abs = negative ? -amount : amount;
+         std::string digits = std::to_string( abs );
+         const uint8_t p = symbol.precision();
+         if ( p ) {
+            if ( digits.size() <= p ) digits.insert( 0, p - digits.size() + 1, '0' );
+            digits.insert( digits.size() - p, 1, '.' );
+         }
+         return ( negative ? "-" : "" ) + digits + " " + symbol.code().to_string();
+      }
+   };
+
+   /**
+    * Host-side stand-in for `eosio::extended_asset`.
+    */
+   struct extended_asset {
+      asset quantity;
+      name contract;
+
+      extended_asset() = default;
+      extended_asset( int64_t v, extended_symbol s ) : quantity( v, s.get_symbol() ), contract( s.get_contract() ) {}
+      extended_asset( asset a, name c ) : quantity( a ), contract( c ) {}
+
+      extended_symbol get_extended_symbol() const { return extended_symbol{ quantity.symbol, contract }; }
+
+      std::string to_string() const { return quantity.to_string() + "@" + contract.to_string(); }
+
+      friend bool operator==( const extended_asset& a, const extended_asset& b ) { return a.contract == b.contract && a.quantity == b.quantity; }
+      friend bool operator!=( const extended_asset& a, const extended_asset& b ) { return !( a == b ); }
+   };
+}
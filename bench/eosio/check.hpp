@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+namespace eosio {
+
+   /**
+    * Thrown by `check` on failure; the host harness catches it where nodeos would abort the transaction.
+    */
+   struct eosio_assert_exception : std::runtime_error {
+      using std::runtime_error::runtime_error;
+   };
+
+   [[noreturn]] inline void eosio_assert_fail( const char* msg )
+   {
+      throw eosio_assert_exception( msg );
+   }
+
+   constexpr void check( bool pred, const char* msg )
+   {
+      if ( !pred ) eosio_assert_fail( msg );
+   }
+
+   inline void check( bool pred, const std::string& msg )
+   {
+      if ( !pred ) eosio_assert_fail( msg.c_str() );
+   }
+
+   inline void check( bool pred, std::string&& msg )
+   {
+      if ( !pred ) eosio_assert_fail( msg.c_str() );
+   }
+
+   inline void check( bool pred, const char* msg, size_t n )
+   {
+      if ( !pred ) eosio_assert_fail( std::string( msg, n ).c_str() );
+   }
+
+   inline void check( bool pred, uint64_t code )
+   {
+      if ( !pred ) eosio_assert_fail( ( "error code " + std::to_string( code ) ).c_str() );
+   }
+}
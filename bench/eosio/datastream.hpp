@@ -0,0 +1,380 @@
+#pragma once
+
+#include "asset.hpp"
+#include "check.hpp"
+#include "name.hpp"
+#include "symbol.hpp"
+
+#include <array>
+#include <cstring>
+#include <map>
+#include <optional>
+#include <set>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace eosio {
+
+   /**
+    * Host-side stand-in for `eosio::datastream`.
+    *
+    * `datastream<char*>` writes, `datastream<const char*>` reads and `datastream<size_t>` only counts bytes,
+    * which is what `pack_size` uses.
+    */
+   template <typename T>
+   class datastream {
+   public:
+      datastream( T start, size_t s ) : _start( start ), _pos( start ), _end( start + s ) {}
+
+      void skip( size_t s ) { _pos += s; }
+      bool read( char* d, size_t s )
+      {
+         check( size_t( _end - _pos ) >= s, "datastream attempted to read past the end" );
+         std::memcpy( d, _pos, s );
+         _pos += s;
+         return true;
+      }
+      bool write( const char* d, size_t s )
+      {
+         check( _end - _pos >= int32_t( s ), "datastream attempted to write past the end" );
+         std::memcpy( (void*) _pos, d, s );
+         _pos += s;
+         return true;
+      }
+      bool write( char d ) { return write( &d, 1 ); }
+      T pos() const { return _pos; }
+      size_t tellp() const { return size_t( _pos - _start ); }
+      size_t remaining() const { return size_t( _end - _pos ); }
+
+   private:
+      T _start;
+      T _pos;
+      T _end;
+   };
+
+   template <>
+   class datastream<size_t> {
+   public:
+      datastream( size_t init_size = 0 ) : _size( init_size ) {}
+      void skip( size_t s ) { _size += s; }
+      bool write( const char*, size_t s ) { _size += s; return true; }
+      bool write( char ) { _size++; return true; }
+      size_t tellp() const { return _size; }
+      size_t remaining() const { return 0; }
+
+   private:
+      size_t _size;
+   };
+
+   // varuint32 length prefixes
+   struct unsigned_int {
+      uint32_t value = 0;
+      unsigned_int( uint32_t v = 0 ) : value( v ) {}
+      operator uint32_t() const { return value; }
+   };
+
+   template <typename Stream>
+   Stream& operator<<( Stream& ds, const unsigned_int& v )
+   {
+      uint64_t val = v.value;
+      do {
+         uint8_t b = uint8_t( val ) & 0x7f;
+         val >>= 7;
+         b |= ( ( val > 0 ) << 7 );
+         ds.write( (char) b );
+      } while ( val );
+      return ds;
+   }
+
+   template <typename Stream>
+   Stream& operator>>( Stream& ds, unsigned_int& vi )
+   {
+      uint64_t v = 0;
+      char b = 0;
+      uint8_t by = 0;
+      do {
+         ds.read( &b, 1 );
+         v |= uint32_t( uint8_t( b ) & 0x7f ) << by;
+         by += 7;
+      } while ( uint8_t( b ) & 0x80 && by < 32 );
+      vi.value = static_cast<uint32_t>( v );
+      return ds;
+   }
+
+   namespace detail {
+      // aggregate reflection used in place of the CDT's clang-only field introspection
+      struct any_field {
+         template <typename T>
+         operator T&() const;
+      };
+
+      template <typename T, typename... A>
+      constexpr auto braces_constructible( int ) -> decltype( T{ std::declval<A>()... }, true ) { return true; }
+      template <typename T, typename... A>
+      constexpr bool braces_constructible( ... ) { return false; }
+
+      template <typename T, typename... A>
+      constexpr size_t field_count()
+      {
+         if constexpr ( sizeof...(A) > 16 ) return sizeof...(A);
+         else if constexpr ( !braces_constructible<T, A..., any_field>( 0 ) ) return sizeof...(A);
+         else return field_count<T, A..., any_field>();
+      }
+
+#define SX_BENCH_FIELDS_1 f1
+#define SX_BENCH_FIELDS_2 SX_BENCH_FIELDS_1, f2
+#define SX_BENCH_FIELDS_3 SX_BENCH_FIELDS_2, f3
+#define SX_BENCH_FIELDS_4 SX_BENCH_FIELDS_3, f4
+#define SX_BENCH_FIELDS_5 SX_BENCH_FIELDS_4, f5
+#define SX_BENCH_FIELDS_6 SX_BENCH_FIELDS_5, f6
+#define SX_BENCH_FIELDS_7 SX_BENCH_FIELDS_6, f7
+#define SX_BENCH_FIELDS_8 SX_BENCH_FIELDS_7, f8
+#define SX_BENCH_FIELDS_9 SX_BENCH_FIELDS_8, f9
+#define SX_BENCH_FIELDS_10 SX_BENCH_FIELDS_9, f10
+#define SX_BENCH_FIELDS_11 SX_BENCH_FIELDS_10, f11
+#define SX_BENCH_FIELDS_12 SX_BENCH_FIELDS_11, f12
+#define SX_BENCH_TIE( N ) if constexpr ( n == N ) { auto& [ SX_BENCH_FIELDS_##N ] = t; f( std::tie( SX_BENCH_FIELDS_##N ) ); } else
+
+      template <typename T, typename F>
+      void for_each_field( T& t, F&& f )
+      {
+         using U = std::remove_const_t<T>;
+         constexpr size_t n = field_count<U>();
+         SX_BENCH_TIE( 1 ) SX_BENCH_TIE( 2 ) SX_BENCH_TIE( 3 ) SX_BENCH_TIE( 4 ) SX_BENCH_TIE( 5 ) SX_BENCH_TIE( 6 )
+         SX_BENCH_TIE( 7 ) SX_BENCH_TIE( 8 ) SX_BENCH_TIE( 9 ) SX_BENCH_TIE( 10 ) SX_BENCH_TIE( 11 ) SX_BENCH_TIE( 12 )
+         if constexpr ( n == 0 ) {}
+         else static_assert( n <= 12, "too many fields for host-side reflection" );
+      }
+#undef SX_BENCH_TIE
+   }
+
+   // arithmetic & enums
+   template <typename Stream, typename T, std::enable_if_t<std::is_arithmetic_v<T> || std::is_enum_v<T>, int> = 0>
+   Stream& operator<<( Stream& ds, const T& v ) { ds.write( (const char*) &v, sizeof( T ) ); return ds; }
+   template <typename Stream, typename T, std::enable_if_t<std::is_arithmetic_v<T> || std::is_enum_v<T>, int> = 0>
+   Stream& operator>>( Stream& ds, T& v ) { ds.read( (char*) &v, sizeof( T ) ); return ds; }
+
+   template <typename Stream>
+   Stream& operator<<( Stream& ds, const bool& v ) { return ds << uint8_t( v ); }
+   template <typename Stream>
+   Stream& operator>>( Stream& ds, bool& v ) { uint8_t b; ds >> b; v = b; return ds; }
+
+   template <typename Stream>
+   Stream& operator<<( Stream& ds, const __uint128_t& v ) { ds.write( (const char*) &v, 16 ); return ds; }
+   template <typename Stream>
+   Stream& operator>>( Stream& ds, __uint128_t& v ) { ds.read( (char*) &v, 16 ); return ds; }
+
+   // eosio types
+   template <typename Stream> Stream& operator<<( Stream& ds, const name& v ) { return ds << v.value; }
+   template <typename Stream> Stream& operator>>( Stream& ds, name& v ) { return ds >> v.value; }
+   template <typename Stream> Stream& operator<<( Stream& ds, const symbol_code& v ) { return ds << v.raw(); }
+   template <typename Stream> Stream& operator>>( Stream& ds, symbol_code& v ) { uint64_t r; ds >> r; v = symbol_code{ r }; return ds; }
+   template <typename Stream> Stream& operator<<( Stream& ds, const symbol& v ) { return ds << v.raw(); }
+   template <typename Stream> Stream& operator>>( Stream& ds, symbol& v ) { uint64_t r; ds >> r; v = symbol{ r }; return ds; }
+   template <typename Stream> Stream& operator<<( Stream& ds, const asset& v ) { return ds << v.amount << v.symbol; }
+   template <typename Stream> Stream& operator>>( Stream& ds, asset& v ) { return ds >> v.amount >> v.symbol; }
+   template <typename Stream> Stream& operator<<( Stream& ds, const extended_symbol& v ) { return ds << v.sym << v.contract; }
+   template <typename Stream> Stream& operator>>( Stream& ds, extended_symbol& v ) { return ds >> v.sym >> v.contract; }
+   template <typename Stream> Stream& operator<<( Stream& ds, const extended_asset& v ) { return ds << v.quantity << v.contract; }
+   template <typename Stream> Stream& operator>>( Stream& ds, extended_asset& v ) { return ds >> v.quantity >> v.contract; }
+
+   // std containers
+   template <typename Stream>
+   Stream& operator<<( Stream& ds, const std::string& v )
+   {
+      ds << unsigned_int( v.size() );
+      if ( v.size() ) ds.write( v.data(), v.size() );
+      return ds;
+   }
+   template <typename Stream>
+   Stream& operator>>( Stream& ds, std::string& v )
+   {
+      unsigned_int s;
+      ds >> s;
+      v.resize( s.value );
+      if ( s.value ) ds.read( v.data(), s.value );
+      return ds;
+   }
+
+   template <typename Stream, typename T>
+   Stream& operator<<( Stream& ds, const std::vector<T>& v )
+   {
+      ds << unsigned_int( v.size() );
+      for ( const auto& i : v ) ds << i;
+      return ds;
+   }
+   template <typename Stream, typename T>
+   Stream& operator>>( Stream& ds, std::vector<T>& v )
+   {
+      unsigned_int s;
+      ds >> s;
+      v.resize( s.value );
+      for ( auto& i : v ) ds >> i;
+      return ds;
+   }
+
+   template <typename Stream, typename T, size_t N>
+   Stream& operator<<( Stream& ds, const std::array<T, N>& v ) { for ( const auto& i : v ) ds << i; return ds; }
+   template <typename Stream, typename T, size_t N>
+   Stream& operator>>( Stream& ds, std::array<T, N>& v ) { for ( auto& i : v ) ds >> i; return ds; }
+
+   template <typename Stream, typename K, typename V>
+   Stream& operator<<( Stream& ds, const std::map<K, V>& m )
+   {
+      ds << unsigned_int( m.size() );
+      for ( const auto& i : m ) ds << i.first << i.second;
+      return ds;
+   }
+   template <typename Stream, typename K, typename V>
+   Stream& operator>>( Stream& ds, std::map<K, V>& m )
+   {
+      m.clear();
+      unsigned_int s;
+      ds >> s;
+      for ( uint32_t i = 0; i < s.value; ++i ) {
+         K k;
+         V v;
+         ds >> k >> v;
+         m.emplace( std::move( k ), std::move( v ) );
+      }
+      return ds;
+   }
+
+   template <typename Stream, typename T>
+   Stream& operator<<( Stream& ds, const std::set<T>& s )
+   {
+      ds << unsigned_int( s.size() );
+      for ( const auto& i : s ) ds << i;
+      return ds;
+   }
+   template <typename Stream, typename T>
+   Stream& operator>>( Stream& ds, std::set<T>& s )
+   {
+      s.clear();
+      unsigned_int n;
+      ds >> n;
+      for ( uint32_t i = 0; i < n.value; ++i ) {
+         T v;
+         ds >> v;
+         s.emplace( std::move( v ) );
+      }
+      return ds;
+   }
+
+   template <typename Stream, typename A, typename B>
+   Stream& operator<<( Stream& ds, const std::pair<A, B>& p ) { return ds << p.first << p.second; }
+   template <typename Stream, typename A, typename B>
+   Stream& operator>>( Stream& ds, std::pair<A, B>& p ) { return ds >> p.first >> p.second; }
+
+   template <typename Stream, typename T>
+   Stream& operator<<( Stream& ds, const std::optional<T>& o )
+   {
+      ds << bool( o.has_value() );
+      if ( o ) ds << *o;
+      return ds;
+   }
+   template <typename Stream, typename T>
+   Stream& operator>>( Stream& ds, std::optional<T>& o )
+   {
+      bool valid;
+      ds >> valid;
+      if ( valid ) {
+         T v;
+         ds >> v;
+         o = std::move( v );
+      } else {
+         o.reset();
+      }
+      return ds;
+   }
+
+   template <typename Stream, typename... Ts>
+   Stream& operator<<( Stream& ds, const std::variant<Ts...>& v )
+   {
+      ds << unsigned_int( v.index() );
+      std::visit( [&]( const auto& x ) { ds << x; }, v );
+      return ds;
+   }
+   template <typename Stream, typename... Ts>
+   Stream& operator>>( Stream& ds, std::variant<Ts...>& v )
+   {
+      unsigned_int index;
+      ds >> index;
+      check( index.value < sizeof...(Ts), "invalid variant index" );
+      std::array<std::variant<Ts...>, sizeof...(Ts)> alternatives = { std::variant<Ts...>( std::in_place_type<Ts> )... };
+      v = alternatives[ index.value ];
+      std::visit( [&]( auto& x ) { ds >> x; }, v );
+      return ds;
+   }
+
+   template <typename Stream, typename... Ts>
+   Stream& operator<<( Stream& ds, const std::tuple<Ts...>& t )
+   {
+      std::apply( [&]( const auto&... x ) { ( ( ds << x ), ... ); }, t );
+      return ds;
+   }
+   template <typename Stream, typename... Ts>
+   Stream& operator>>( Stream& ds, std::tuple<Ts...>& t )
+   {
+      std::apply( [&]( auto&... x ) { ( ( ds >> x ), ... ); }, t );
+      return ds;
+   }
+
+   namespace detail {
+      template <typename T> struct is_std_array : std::false_type {};
+      template <typename T, size_t N> struct is_std_array<std::array<T, N>> : std::true_type {};
+
+      template <typename T>
+      constexpr bool is_reflected_v = std::is_class_v<T> && std::is_aggregate_v<T> && !is_std_array<T>::value;
+   }
+
+   // plain aggregates (table rows, action structs)
+   template <typename Stream, typename T,
+             std::enable_if_t<detail::is_reflected_v<T>, int> = 0>
+   Stream& operator<<( Stream& ds, const T& v )
+   {
+      detail::for_each_field( v, [&]( const auto& fields ) { std::apply( [&]( const auto&... x ) { ( ( ds << x ), ... ); }, fields ); } );
+      return ds;
+   }
+   template <typename Stream, typename T,
+             std::enable_if_t<detail::is_reflected_v<T>, int> = 0>
+   Stream& operator>>( Stream& ds, T& v )
+   {
+      detail::for_each_field( v, [&]( const auto& fields ) { std::apply( [&]( auto&... x ) { ( ( ds >> x ), ... ); }, fields ); } );
+      return ds;
+   }
+
+   template <typename T>
+   size_t pack_size( const T& value )
+   {
+      datastream<size_t> ps;
+      ps << value;
+      return ps.tellp();
+   }
+
+   template <typename T>
+   std::vector<char> pack( const T& value )
+   {
+      std::vector<char> result;
+      result.resize( pack_size( value ) );
+      datastream<char*> ds( result.data(), result.size() );
+      ds << value;
+      return result;
+   }
+
+   template <typename T>
+   T unpack( const char* buffer, size_t len )
+   {
+      T result{};
+      datastream<const char*> ds( buffer, len );
+      ds >> result;
+      return result;
+   }
+
+   template <typename T>
+   T unpack( const std::vector<char>& bytes ) { return unpack<T>( bytes.data(), bytes.size() ); }
+}
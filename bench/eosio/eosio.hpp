@@ -0,0 +1,19 @@
+#pragma once
+
+/**
+ * Host-side stand-in for the EOSIO CDT umbrella header.
+ *
+ * Only the surface wallet.sx and eosio.token.hpp use is modelled; see `bench/README.md`.
+ */
+#include "action.hpp"
+#include "asset.hpp"
+#include "check.hpp"
+#include "contract.hpp"
+#include "crypto.hpp"
+#include "datastream.hpp"
+#include "host.hpp"
+#include "multi_index.hpp"
+#include "name.hpp"
+#include "symbol.hpp"
+#include "system.hpp"
+#include "time.hpp"
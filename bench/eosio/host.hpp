@@ -0,0 +1,131 @@
+#pragma once
+
+#include "name.hpp"
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace eosio {
+
+   struct permission_level {
+      permission_level() = default;
+      permission_level( name a, name p ) : actor( a ), permission( p ) {}
+
+      name actor;
+      name permission;
+
+      friend bool operator==( const permission_level& a, const permission_level& b ) { return a.actor == b.actor && a.permission == b.permission; }
+      friend bool operator<( const permission_level& a, const permission_level& b ) { return std::tie( a.actor, a.permission ) < std::tie( b.actor, b.permission ); }
+   };
+
+   template <typename Stream> Stream& operator<<( Stream& ds, const permission_level& v ) { return ds << v.actor << v.permission; }
+   template <typename Stream> Stream& operator>>( Stream& ds, permission_level& v ) { return ds >> v.actor >> v.permission; }
+
+   /**
+    * Mock chain state shared by every intrinsic stand-in.
+    *
+    * The harness drives it directly: it seeds accounts, grants authorizations, advances the clock
+    * and reads the counters to report per-operation costs.
+    */
+   namespace host {
+
+      struct cost_counters {
+         uint64_t db_finds = 0;          // primary/secondary lookups & iterator steps
+         uint64_t db_reads = 0;          // rows deserialized
+         uint64_t db_writes = 0;         // rows serialized (store + update)
+         uint64_t db_erases = 0;
+         uint64_t bytes_read = 0;
+         uint64_t bytes_written = 0;
+         int64_t  ram_delta = 0;         // billable bytes (row size + 112 overhead per row)
+         uint64_t inline_actions = 0;
+         uint64_t intrinsics = 0;
+      };
+
+      struct row {
+         std::vector<char> data;
+         name payer;
+      };
+
+      using table_id = std::tuple<uint64_t, uint64_t, uint64_t>; // code, scope, table
+
+      struct inline_action {
+         name account;
+         name action;
+         std::vector<permission_level> authorization;
+         std::vector<char> data;
+      };
+
+      struct chain_state {
+         std::map<table_id, std::map<uint64_t, row>> tables;
+         std::set<name> accounts;
+         std::set<name> auths;
+         std::vector<inline_action> actions;
+         name receiver;
+         name first_receiver;
+         int64_t now_us = 1600000000ll * 1000000ll;
+         cost_counters counters;
+      };
+
+      inline chain_state& state()
+      {
+         static chain_state s;
+         return s;
+      }
+
+      inline cost_counters& counters() { return state().counters; }
+
+      /**
+       * Heap allocations made while `tracking()` is false belong to the mock chain (row storage,
+       * captured actions) rather than to the contract, and are not reported by the harness.
+       */
+      inline bool& tracking()
+      {
+         static bool t = true;
+         return t;
+      }
+
+      struct untracked {
+         bool prev;
+         untracked() : prev( tracking() ) { tracking() = false; }
+         ~untracked() { tracking() = prev; }
+      };
+
+      /**
+       * Heap allocations made by CDT library code on behalf of the contract (table row cache objects,
+       * inline action packing) also happen on-chain, but are counted apart from the contract's own.
+       */
+      inline int& library_depth()
+      {
+         static int depth = 0;
+         return depth;
+      }
+
+      struct library {
+         library() { library_depth()++; }
+         ~library() { library_depth()--; }
+      };
+
+      // billable RAM overhead of a `key_value_object` / secondary index object
+      static constexpr int64_t row_overhead = 112;
+
+      /**
+       * Set the auth & receiver context for the next action.
+       */
+      inline void set_action_context( name receiver, name first_receiver, std::set<name> auths )
+      {
+         auto& s = state();
+         s.receiver = receiver;
+         s.first_receiver = first_receiver;
+         s.auths = std::move( auths );
+      }
+
+      inline void reset()
+      {
+         state() = chain_state{};
+      }
+   }
+}
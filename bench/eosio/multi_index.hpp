@@ -0,0 +1,478 @@
+#pragma once
+
+#include "check.hpp"
+#include "datastream.hpp"
+#include "host.hpp"
+
+#include <iterator>
+#include <map>
+#include <memory>
+#include <set>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// global like CDT's `eosio/types.h`
+typedef unsigned __int128 uint128_t;
+
+namespace eosio {
+
+   static constexpr name same_payer{};
+
+   template <name::raw IndexName, typename Extractor>
+   struct indexed_by {
+      enum constants { index_name = static_cast<uint64_t>( IndexName ) };
+      typedef Extractor secondary_extractor_type;
+   };
+
+   template <class Class, typename Type, Type ( Class::*PtrToMemberFunction )() const>
+   struct const_mem_fun {
+      typedef typename std::remove_reference<Type>::type result_type;
+      result_type operator()( const Class& x ) const { return ( x.*PtrToMemberFunction )(); }
+   };
+
+   namespace host {
+      // every supported secondary key (uint64_t, uint128_t) is stored widened to 128 bits
+      using secondary_key = __uint128_t;
+      using secondary_table = std::set<std::pair<secondary_key, uint64_t>>;
+
+      inline std::map<table_id, secondary_table>& secondaries()
+      {
+         static std::map<table_id, secondary_table> s;
+         return s;
+      }
+
+      inline void reset_all()
+      {
+         reset();
+         secondaries().clear();
+      }
+
+      inline int64_t secondary_overhead( size_t key_size ) { return key_size > 8 ? 136 : 128; }
+   }
+
+   /**
+    * Host-side stand-in for `eosio::multi_index`, backed by the mock chain state in `host.hpp`.
+    *
+    * Rows are kept serialized exactly like nodeos keeps them, so every first access of a row in
+    * a table instance pays a real `unpack` and every `emplace`/`modify` pays a real `pack`.
+    */
+   template <name::raw TableName, typename T, typename... Indices>
+   class multi_index {
+   private:
+      static constexpr uint64_t table_name = static_cast<uint64_t>( TableName );
+
+      name _code;
+      uint64_t _scope;
+      mutable std::map<uint64_t, std::unique_ptr<T>> _items;
+
+      host::table_id tid() const { return host::table_id{ _code.value, _scope, table_name }; }
+
+      static host::table_id sid( name code, uint64_t scope, uint64_t n )
+      {
+         return host::table_id{ code.value, scope, ( table_name & 0xFFFFFFFFFFFFFFF0ULL ) | n };
+      }
+
+      std::map<uint64_t, host::row>* rows() const
+      {
+         auto& tables = host::state().tables;
+         auto itr = tables.find( tid() );
+         return itr == tables.end() ? nullptr : &itr->second;
+      }
+
+      std::map<uint64_t, host::row>& rows_or_create() const
+      {
+         host::untracked guard;
+         auto& tables = host::state().tables;
+         auto itr = tables.find( tid() );
+         if ( itr == tables.end() ) {
+            host::counters().ram_delta += host::row_overhead;
+            itr = tables.emplace( tid(), std::map<uint64_t, host::row>{} ).first;
+         }
+         return itr->second;
+      }
+
+      template <size_t N, typename Index>
+      void for_secondary( const T& obj, uint64_t pk, bool insert ) const
+      {
+         using extractor = typename Index::secondary_extractor_type;
+         const auto key = extractor{}( obj );
+         host::untracked guard;
+         auto& table = host::secondaries()[ sid( _code, _scope, N ) ];
+         if ( insert ) {
+            table.emplace( host::secondary_key( key ), pk );
+            host::counters().ram_delta += host::secondary_overhead( sizeof( key ) );
+         } else {
+            table.erase( { host::secondary_key( key ), pk } );
+            host::counters().ram_delta -= host::secondary_overhead( sizeof( key ) );
+         }
+      }
+
+      template <size_t... Is>
+      void update_secondaries( const T& obj, uint64_t pk, bool insert, std::index_sequence<Is...> ) const
+      {
+         ( for_secondary<Is, std::tuple_element_t<Is, std::tuple<Indices...>>>( obj, pk, insert ), ... );
+      }
+
+      void update_secondaries( const T& obj, uint64_t pk, bool insert ) const
+      {
+         update_secondaries( obj, pk, insert, std::index_sequence_for<Indices...>{} );
+      }
+
+   public:
+      multi_index( name code, uint64_t scope ) : _code( code ), _scope( scope ) {}
+
+      multi_index( const multi_index& ) = delete;
+      multi_index& operator=( const multi_index& ) = delete;
+
+      name get_code() const { return _code; }
+      uint64_t get_scope() const { return _scope; }
+
+      // load a row into the instance cache, deserializing it on first access
+      const T* load( uint64_t pk ) const
+      {
+         auto cached = _items.find( pk );
+         if ( cached != _items.end() ) return cached->second.get();
+
+         auto* r = rows();
+         if ( !r ) return nullptr;
+         auto itr = r->find( pk );
+         if ( itr == r->end() ) return nullptr;
+
+         host::counters().db_reads++;
+         host::counters().bytes_read += itr->second.data.size();
+         host::library guard;
+         auto obj = std::make_unique<T>( unpack<T>( itr->second.data ) );
+         const T* ptr = obj.get();
+         _items.emplace( pk, std::move( obj ) );
+         return ptr;
+      }
+
+      struct const_iterator {
+         using iterator_category = std::bidirectional_iterator_tag;
+         using value_type = const T;
+         using difference_type = std::ptrdiff_t;
+         using pointer = const T*;
+         using reference = const T&;
+
+         const multi_index* _idx = nullptr;
+         bool _end = true;
+         uint64_t _pk = 0;
+
+         const T& operator*() const
+         {
+            check( !_end, "cannot dereference end iterator" );
+            return *_idx->load( _pk );
+         }
+         const T* operator->() const { return &**this; }
+
+         const_iterator& operator++()
+         {
+            check( !_end, "cannot increment end iterator" );
+            host::counters().db_finds++;
+            auto* r = _idx->rows();
+            auto next = r ? r->upper_bound( _pk ) : decltype( r->end() ){};
+            if ( !r || next == r->end() ) _end = true;
+            else _pk = next->first;
+            return *this;
+         }
+         const_iterator operator++( int ) { auto tmp = *this; ++*this; return tmp; }
+
+         const_iterator& operator--()
+         {
+            host::counters().db_finds++;
+            auto* r = _idx->rows();
+            check( r && !r->empty(), "cannot decrement iterator at beginning of table" );
+            if ( _end ) {
+               _pk = std::prev( r->end() )->first;
+               _end = false;
+               return *this;
+            }
+            auto itr = r->lower_bound( _pk );
+            check( itr != r->begin(), "cannot decrement iterator at beginning of table" );
+            _pk = std::prev( itr )->first;
+            return *this;
+         }
+         const_iterator operator--( int ) { auto tmp = *this; --*this; return tmp; }
+
+         friend bool operator==( const const_iterator& a, const const_iterator& b ) { return a._end == b._end && ( a._end || a._pk == b._pk ); }
+         friend bool operator!=( const const_iterator& a, const const_iterator& b ) { return !( a == b ); }
+      };
+
+      const_iterator make_iterator( uint64_t pk ) const { return const_iterator{ this, false, pk }; }
+
+      const_iterator end() const { return const_iterator{ this, true, 0 }; }
+      const_iterator cend() const { return end(); }
+
+      const_iterator begin() const
+      {
+         host::counters().db_finds++;
+         auto* r = rows();
+         if ( !r || r->empty() ) return end();
+         return make_iterator( r->begin()->first );
+      }
+      const_iterator cbegin() const { return begin(); }
+
+      const_iterator lower_bound( uint64_t pk ) const
+      {
+         host::counters().db_finds++;
+         auto* r = rows();
+         if ( !r ) return end();
+         auto itr = r->lower_bound( pk );
+         return itr == r->end() ? end() : make_iterator( itr->first );
+      }
+
+      const_iterator upper_bound( uint64_t pk ) const
+      {
+         host::counters().db_finds++;
+         auto* r = rows();
+         if ( !r ) return end();
+         auto itr = r->upper_bound( pk );
+         return itr == r->end() ? end() : make_iterator( itr->first );
+      }
+
+      const_iterator find( uint64_t pk ) const
+      {
+         if ( _items.count( pk ) ) return make_iterator( pk );
+         host::counters().db_finds++;
+         auto* r = rows();
+         if ( !r || !r->count( pk ) ) return end();
+         return make_iterator( pk );
+      }
+
+      const_iterator require_find( uint64_t pk, const char* error_msg = "unable to find key" ) const
+      {
+         auto itr = find( pk );
+         check( itr != end(), error_msg );
+         return itr;
+      }
+
+      const T& get( uint64_t pk, const char* error_msg = "unable to find key" ) const
+      {
+         auto itr = find( pk );
+         check( itr != end(), error_msg );
+         return *itr;
+      }
+
+      const_iterator iterator_to( const T& obj ) const { return make_iterator( obj.primary_key() ); }
+
+      uint64_t available_primary_key() const
+      {
+         auto* r = rows();
+         if ( !r || r->empty() ) return 0;
+         return std::prev( r->end() )->first + 1;
+      }
+
+      template <typename Lambda>
+      const_iterator emplace( name payer, Lambda&& constructor )
+      {
+         check( _code == host::state().receiver, "cannot create objects in table of another contract" );
+         check( bool( payer ), "must specify a valid account to pay for new record" );
+
+         auto obj = [] { host::library guard; return std::make_unique<T>(); }();
+         constructor( *obj );
+         const uint64_t pk = obj->primary_key();
+
+         auto& r = rows_or_create();
+         check( !r.count( pk ), "could not insert object, most likely a uniqueness constraint was violated" );
+
+         host::untracked guard;
+         auto data = pack( *obj );
+         host::counters().db_writes++;
+         host::counters().bytes_written += data.size();
+         host::counters().ram_delta += int64_t( data.size() ) + host::row_overhead;
+         r.emplace( pk, host::row{ std::move( data ), payer } );
+         update_secondaries( *obj, pk, true );
+
+         _items[ pk ] = std::move( obj );
+         return make_iterator( pk );
+      }
+
+      template <typename Lambda>
+      void modify( const_iterator itr, name payer, Lambda&& updater )
+      {
+         check( itr != end(), "cannot pass end iterator to modify" );
+         modify( *itr, payer, std::forward<Lambda>( updater ) );
+      }
+
+      template <typename Lambda>
+      void modify( const T& obj, name payer, Lambda&& updater )
+      {
+         check( _code == host::state().receiver, "cannot modify objects in table of another contract" );
+         const uint64_t pk = obj.primary_key();
+         auto& mutable_obj = const_cast<T&>( obj );
+
+         update_secondaries( obj, pk, false );
+         updater( mutable_obj );
+         check( pk == mutable_obj.primary_key(), "updater cannot change primary key when modifying an object" );
+         update_secondaries( obj, pk, true );
+
+         auto& stored = rows_or_create().at( pk );
+         host::untracked guard;
+         auto data = pack( obj );
+         host::counters().db_writes++;
+         host::counters().bytes_written += data.size();
+         host::counters().ram_delta += int64_t( data.size() ) - int64_t( stored.data.size() );
+         stored.data = std::move( data );
+         if ( payer ) stored.payer = payer;
+      }
+
+      const_iterator erase( const_iterator itr )
+      {
+         check( itr != end(), "cannot pass end iterator to erase" );
+         const auto next = std::next( itr );
+         erase( *itr );
+         return next;
+      }
+
+      void erase( const T& obj )
+      {
+         check( _code == host::state().receiver, "cannot erase objects in table of another contract" );
+         const uint64_t pk = obj.primary_key();
+         update_secondaries( obj, pk, false );
+
+         auto& r = rows_or_create();
+         auto stored = r.find( pk );
+         check( stored != r.end(), "attempt to remove object that was not in multi_index" );
+         host::counters().db_erases++;
+         host::untracked guard;
+         host::counters().ram_delta -= int64_t( stored->second.data.size() ) + host::row_overhead;
+         r.erase( stored );
+         if ( r.empty() ) {
+            host::state().tables.erase( tid() );
+            host::counters().ram_delta -= host::row_overhead;
+         }
+         _items.erase( pk );
+      }
+
+      /**
+       * Secondary index view, ordered by (secondary key, primary key).
+       */
+      template <size_t N, typename Extractor>
+      class index {
+      public:
+         using secondary_key_type = typename Extractor::result_type;
+
+         struct const_iterator {
+            const index* _idx = nullptr;
+            bool _end = true;
+            secondary_key_type _key{};
+            uint64_t _pk = 0;
+
+            const T& operator*() const
+            {
+               check( !_end, "cannot dereference end iterator" );
+               return *_idx->_mi->load( _pk );
+            }
+            const T* operator->() const { return &**this; }
+
+            const_iterator& operator++()
+            {
+               check( !_end, "cannot increment end iterator" );
+               host::counters().db_finds++;
+               auto& table = _idx->table();
+               auto next = table.upper_bound( { host::secondary_key( _key ), _pk } );
+               if ( next == table.end() ) _end = true;
+               else { _key = secondary_key_type( next->first ); _pk = next->second; }
+               return *this;
+            }
+            const_iterator operator++( int ) { auto tmp = *this; ++*this; return tmp; }
+
+            const_iterator& operator--()
+            {
+               host::counters().db_finds++;
+               auto& table = _idx->table();
+               check( !table.empty(), "cannot decrement iterator at beginning of index" );
+               auto itr = _end ? table.end() : table.lower_bound( { host::secondary_key( _key ), _pk } );
+               check( itr != table.begin(), "cannot decrement iterator at beginning of index" );
+               --itr;
+               _end = false;
+               _key = secondary_key_type( itr->first );
+               _pk = itr->second;
+               return *this;
+            }
+
+            friend bool operator==( const const_iterator& a, const const_iterator& b ) { return a._end == b._end && ( a._end || ( a._key == b._key && a._pk == b._pk ) ); }
+            friend bool operator!=( const const_iterator& a, const const_iterator& b ) { return !( a == b ); }
+         };
+
+         explicit index( const multi_index* mi ) : _mi( mi ) {}
+
+         host::secondary_table& table() const { return host::secondaries()[ sid( _mi->_code, _mi->_scope, N ) ]; }
+
+         const_iterator make( typename host::secondary_table::const_iterator itr ) const
+         {
+            if ( itr == table().end() ) return end();
+            return const_iterator{ this, false, secondary_key_type( itr->first ), itr->second };
+         }
+
+         const_iterator end() const { return const_iterator{ this, true, {}, 0 }; }
+         const_iterator begin() const { host::counters().db_finds++; return make( table().begin() ); }
+
+         const_iterator lower_bound( secondary_key_type key ) const
+         {
+            host::counters().db_finds++;
+            return make( table().lower_bound( { host::secondary_key( key ), 0 } ) );
+         }
+
+         const_iterator upper_bound( secondary_key_type key ) const
+         {
+            host::counters().db_finds++;
+            return make( table().upper_bound( { host::secondary_key( key ), UINT64_MAX } ) );
+         }
+
+         const_iterator find( secondary_key_type key ) const
+         {
+            auto itr = lower_bound( key );
+            if ( itr == end() || itr._key != key ) return end();
+            return itr;
+         }
+
+         const T& get( secondary_key_type key, const char* error_msg = "unable to find secondary key" ) const
+         {
+            auto itr = find( key );
+            check( itr != end(), error_msg );
+            return *itr;
+         }
+
+         const_iterator iterator_to( const T& obj ) const
+         {
+            return const_iterator{ this, false, Extractor{}( obj ), obj.primary_key() };
+         }
+
+         template <typename Lambda>
+         void modify( const_iterator itr, name payer, Lambda&& updater )
+         {
+            const_cast<multi_index*>( _mi )->modify( *itr, payer, std::forward<Lambda>( updater ) );
+         }
+
+         const_iterator erase( const_iterator itr )
+         {
+            auto next = itr;
+            ++next;
+            const_cast<multi_index*>( _mi )->erase( *itr );
+            return next;
+         }
+
+         const multi_index* _mi;
+      };
+
+      template <name::raw IndexName>
+      auto get_index() const
+      {
+         constexpr size_t n = index_number<IndexName>( std::index_sequence_for<Indices...>{} );
+         static_assert( n < sizeof...(Indices), "name provided is not the name of any secondary index within multi_index" );
+         using extractor = typename std::tuple_element_t<n, std::tuple<Indices...>>::secondary_extractor_type;
+         return index<n, extractor>( this );
+      }
+
+   private:
+      template <name::raw IndexName, size_t... Is>
+      static constexpr size_t index_number( std::index_sequence<Is...> )
+      {
+         size_t n = sizeof...(Indices);
+         ( ( std::tuple_element_t<Is, std::tuple<Indices...>>::index_name == static_cast<uint64_t>( IndexName ) && n == sizeof...(Indices) ? ( n = Is ) : 0 ), ... );
+         return n;
+      }
+   };
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "check.hpp"
+#include "host.hpp"
+#include "time.hpp"
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+namespace eosio {
+
+   inline void require_auth( name n )
+   {
+      host::counters().intrinsics++;
+      check( host::state().auths.count( n ), "missing required authority" );
+   }
+
+   inline void require_auth( const permission_level& level ) { require_auth( level.actor ); }
+
+   inline bool has_auth( name n )
+   {
+      host::counters().intrinsics++;
+      return host::state().auths.count( n );
+   }
+
+   inline bool is_account( name n )
+   {
+      host::counters().intrinsics++;
+      return host::state().accounts.count( n );
+   }
+
+   inline void require_recipient( name ) { host::counters().intrinsics++; }
+
+   inline time_point current_time_point()
+   {
+      host::counters().intrinsics++;
+      return time_point( microseconds( host::state().now_us ) );
+   }
+
+   inline block_timestamp current_block_time() { return block_timestamp( current_time_point() ); }
+
+   inline uint32_t current_block_number()
+   {
+      return block_timestamp( current_time_point() ).slot;
+   }
+
+   // console output is dropped; the harness measures, it doesn't print
+   inline void print( const char* ) {}
+   inline void print( const std::string& ) {}
+   inline void print( std::string_view ) {}
+   template <typename T> void print( const T& ) {}
+   template <typename T, typename... Ts> void print( const T&, const Ts&... ) {}
+}
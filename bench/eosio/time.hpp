@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+
+namespace eosio {
+
+   class microseconds {
+   public:
+      explicit constexpr microseconds( int64_t c = 0 ) : _count( c ) {}
+      constexpr int64_t count() const { return _count; }
+      constexpr int64_t to_seconds() const { return _count / 1000000; }
+      friend constexpr bool operator==( const microseconds& a, const microseconds& b ) { return a._count == b._count; }
+      friend constexpr bool operator<( const microseconds& a, const microseconds& b ) { return a._count < b._count; }
+      friend constexpr microseconds operator+( const microseconds& a, const microseconds& b ) { return microseconds( a._count + b._count ); }
+      friend constexpr microseconds operator-( const microseconds& a, const microseconds& b ) { return microseconds( a._count - b._count ); }
+      int64_t _count;
+   };
+
+   inline constexpr microseconds seconds( int64_t s ) { return microseconds( s * 1000000 ); }
+   inline constexpr microseconds milliseconds( int64_t s ) { return microseconds( s * 1000 ); }
+   inline constexpr microseconds minutes( int64_t m ) { return seconds( 60 * m ); }
+   inline constexpr microseconds hours( int64_t h ) { return minutes( 60 * h ); }
+   inline constexpr microseconds days( int64_t d ) { return hours( 24 * d ); }
+
+   class time_point {
+   public:
+      explicit constexpr time_point( microseconds e = microseconds() ) : elapsed( e ) {}
+      constexpr const microseconds& time_since_epoch() const { return elapsed; }
+      constexpr uint32_t sec_since_epoch() const { return uint32_t( elapsed.count() / 1000000 ); }
+      friend constexpr bool operator==( const time_point& a, const time_point& b ) { return a.elapsed == b.elapsed; }
+      friend constexpr bool operator!=( const time_point& a, const time_point& b ) { return !( a == b ); }
+      friend constexpr bool operator<( const time_point& a, const time_point& b ) { return a.elapsed < b.elapsed; }
+      friend constexpr time_point operator+( const time_point& t, const microseconds& m ) { return time_point( t.elapsed + m ); }
+      friend constexpr microseconds operator-( const time_point& a, const time_point& b ) { return a.elapsed - b.elapsed; }
+      microseconds elapsed;
+   };
+
+   class time_point_sec {
+   public:
+      constexpr time_point_sec() : utc_seconds( 0 ) {}
+      constexpr explicit time_point_sec( uint32_t seconds ) : utc_seconds( seconds ) {}
+      constexpr time_point_sec( const time_point& t ) : utc_seconds( uint32_t( t.time_since_epoch().count() / 1000000ll ) ) {}
+      constexpr uint32_t sec_since_epoch() const { return utc_seconds; }
+      constexpr operator time_point() const { return time_point( eosio::seconds( utc_seconds ) ); }
+      friend constexpr bool operator==( const time_point_sec& a, const time_point_sec& b ) { return a.utc_seconds == b.utc_seconds; }
+      friend constexpr bool operator!=( const time_point_sec& a, const time_point_sec& b ) { return a.utc_seconds != b.utc_seconds; }
+      friend constexpr bool operator<( const time_point_sec& a, const time_point_sec& b ) { return a.utc_seconds < b.utc_seconds; }
+      friend constexpr bool operator<=( const time_point_sec& a, const time_point_sec& b ) { return a.utc_seconds <= b.utc_seconds; }
+      friend constexpr bool operator>( const time_point_sec& a, const time_point_sec& b ) { return a.utc_seconds > b.utc_seconds; }
+      friend constexpr bool operator>=( const time_point_sec& a, const time_point_sec& b ) { return a.utc_seconds >= b.utc_seconds; }
+      friend constexpr time_point_sec operator+( const time_point_sec& t, uint32_t offset ) { return time_point_sec( t.utc_seconds + offset ); }
+      uint32_t utc_seconds;
+   };
+
+   /**
+    * 500ms block slots since 2000-01-01, as produced by `current_block_time()`.
+    */
+   class block_timestamp {
+   public:
+      static constexpr int32_t block_interval_ms = 500;
+      static constexpr int64_t block_timestamp_epoch = 946684800000ll;
+
+      constexpr block_timestamp() : slot( 0 ) {}
+      explicit constexpr block_timestamp( uint32_t s ) : slot( s ) {}
+      block_timestamp( const time_point& t ) { set_time_point( t ); }
+
+      time_point to_time_point() const
+      {
+         return time_point( milliseconds( int64_t( slot ) * block_interval_ms + block_timestamp_epoch ) );
+      }
+      operator time_point() const { return to_time_point(); }
+
+      friend constexpr bool operator==( const block_timestamp& a, const block_timestamp& b ) { return a.slot == b.slot; }
+      friend constexpr bool operator!=( const block_timestamp& a, const block_timestamp& b ) { return a.slot != b.slot; }
+      friend constexpr bool operator<( const block_timestamp& a, const block_timestamp& b ) { return a.slot < b.slot; }
+
+      uint32_t slot;
+
+   private:
+      void set_time_point( const time_point& t )
+      {
+         const int64_t ms = t.time_since_epoch().count() / 1000;
+         slot = uint32_t( ( ms - block_timestamp_epoch ) / block_interval_ms );
+      }
+   };
+
+   template <typename Stream> Stream& operator<<( Stream& ds, const microseconds& v ) { return ds << v._count; }
+   template <typename Stream> Stream& operator>>( Stream& ds, microseconds& v ) { return ds >> v._count; }
+   template <typename Stream> Stream& operator<<( Stream& ds, const time_point& v ) { return ds << v.elapsed; }
+   template <typename Stream> Stream& operator>>( Stream& ds, time_point& v ) { return ds >> v.elapsed; }
+   template <typename Stream> Stream& operator<<( Stream& ds, const time_point_sec& v ) { return ds << v.utc_seconds; }
+   template <typename Stream> Stream& operator>>( Stream& ds, time_point_sec& v ) { return ds >> v.utc_seconds; }
+   template <typename Stream> Stream& operator<<( Stream& ds, const block_timestamp& v ) { return ds << v.slot; }
+   template <typename Stream> Stream& operator>>( Stream& ds, block_timestamp& v ) { return ds >> v.slot; }
+}
@@ -0,0 +1,164 @@
+/**
+ * Storage layout comparison of wallet.sx balances.
+ *
+ * Fills the legacy `balances` (map of full assets per token contract), a row per token contract & symbol
+ * (`per-symbol`, not deployed) and compact `amounts` (varuint symbol code & amount per symbol, precision in
+ * `tokens` cache) layouts with the same holders, then reports billable RAM per holder and the cost of
+ * reading & updating a single balance.
+ *
+ * usage: ./scripts/bench_layout.sh [iterations=200000] [holders=1000]
+ */
+#include "../wallet.sx.cpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+
+using namespace eosio;
+
+namespace {
+
+   const name self = "wallet.sx"_n;
+   const name token_contract = "eosio.token"_n;
+
+   name holder_name( uint32_t i )
+   {
+      string str = "user";
+      for ( int c = 0; c < 4; c++, i /= 26 ) str += char( 'a' + i % 26 );
+      return name{ str };
+   }
+
+   symbol symbol_at( uint32_t i )
+   {
+      string str = "S";
+      for ( int c = 0; c < 3; c++, i /= 26 ) str += char( 'A' + i % 26 );
+      return symbol{ str, 4 };
+   }
+
+   // one fixed-size row per token contract & symbol, keyed by `balance_key` & decoded with the token cache
+   struct per_symbol_row {
+      uint64_t id;
+      int64_t amount;
+
+      uint64_t primary_key() const { return id; }
+   };
+   typedef eosio::multi_index< "persymbol"_n, per_symbol_row > per_symbol;
+
+   struct layout {
+      const char* label;
+      std::function<void( name, const vector<symbol>& )> fill;       // create every balance of a holder
+      std::function<void( name, symbol )> update;                      // read & add 1 to one balance
+   };
+
+   const vector<layout> layouts = {
+      { "balances",
+        []( const name holder, const vector<symbol>& symbols ) {
+           sx::wallet::balances _balances( self, holder.value );
+           _balances.emplace( self, [&]( auto& row ) {
+              row.contract = token_contract;
+              for ( const symbol sym : symbols ) row.balances[ sym.code() ] = asset{ 1, sym };
+           });
+        },
+        []( const name holder, const symbol sym ) {
+           sx::wallet::balances _balances( self, holder.value );
+           const auto itr = _balances.find( token_contract.value );
+           _balances.modify( itr, same_payer, [&]( auto& row ) {
+              row.balances[ sym.code() ] += asset{ 1, sym };
+           });
+        } },
+      { "per-symbol",
+        []( const name holder, const vector<symbol>& symbols ) {
+           per_symbol _rows( self, holder.value );
+           for ( const symbol sym : symbols ) {
+              _rows.emplace( self, [&]( auto& row ) {
+                 row.id = sx::wallet::balance_key( token_contract, sym.code() );
+                 row.amount = 1;
+              });
+           }
+        },
+        []( const name holder, const symbol sym ) {
+           per_symbol _rows( self, holder.value );
+           sx::wallet::tokens _tokens( self, self.value );
+           const uint64_t id = sx::wallet::balance_key( token_contract, sym.code() );
+           const auto itr = _rows.find( id );
+           const symbol cached = _tokens.get( id ).sym.get_symbol();
+           const asset balance = asset{ itr->amount, cached } + asset{ 1, sym };
+           _rows.modify( itr, same_payer, [&]( auto& row ) {
+              row.amount = balance.amount;
+           });
+        } },
+      { "amounts",
+        []( const name holder, const vector<symbol>& symbols ) {
+           sx::wallet::amounts _amounts( self, holder.value );
+           _amounts.emplace( self, [&]( auto& row ) {
+              row.contract = token_contract;
+              for ( const symbol sym : symbols ) {
+                 sx::compact::write( row.entries, sx::compact::find( row.entries, sym.code() ), 1 );
+              }
+           });
+        },
+        []( const name holder, const symbol sym ) {
+           // decode with the token cache, as `get_balance` does
+           sx::wallet::amounts _amounts( self, holder.value );
+           sx::wallet::tokens _tokens( self, self.value );
+           const auto itr = _amounts.find( token_contract.value );
+           const sx::compact::entry entry = sx::compact::find( itr->entries, sym.code() );
+           const symbol cached = _tokens.get( sx::wallet::balance_key( token_contract, sym.code() ) ).sym.get_symbol();
+           const asset balance = asset{ entry.amount, cached } + asset{ 1, sym };
+           _amounts.modify( itr, same_payer, [&]( auto& row ) {
+              sx::compact::write( row.entries, entry, balance.amount );
+           });
+        } },
+   };
+
+   void run( const layout& l, const uint64_t iterations, const uint32_t holders, const uint32_t symbols )
+   {
+      host::reset_all();
+      host::set_action_context( self, self, { self } );
+
+      vector<symbol> syms;
+      sx::wallet::tokens _tokens( self, self.value );
+      for ( uint32_t i = 0; i < symbols; i++ ) {
+         syms.push_back( symbol_at( i ) );
+         _tokens.emplace( self, [&]( auto& row ) {
+            row.id = sx::wallet::balance_key( token_contract, syms.back().code() );
+            row.sym = extended_symbol{ syms.back(), token_contract };
+         });
+      }
+
+      // token cache is shared by all holders, excluded from RAM per holder
+      host::counters() = {};
+      for ( uint32_t i = 0; i < holders; i++ ) l.fill( holder_name( i ), syms );
+      const double ram = double( host::counters().ram_delta ) / holders;
+
+      host::counters() = {};
+      const auto start = std::chrono::steady_clock::now();
+      for ( uint64_t i = 0; i < iterations; i++ ) {
+         l.update( holder_name( i % holders ), syms[ ( i / holders ) % symbols ] );
+      }
+      const auto end = std::chrono::steady_clock::now();
+
+      const auto& c = host::counters();
+      const double n = double( iterations );
+      printf( "%-10s %8u %12.1f %10.1f %10.1f %10.1f %8.2f\n",
+              l.label, symbols, ram,
+              std::chrono::duration<double, std::nano>( end - start ).count() / n,
+              double( c.bytes_read ) / n,
+              double( c.bytes_written ) / n,
+              double( c.db_reads ) / n );
+   }
+}
+
+int main( int argc, char** argv )
+{
+   const uint64_t iterations = argc > 1 ? std::strtoull( argv[1], nullptr, 10 ) : 200000;
+   const uint32_t holders = argc > 2 ? std::strtoul( argv[2], nullptr, 10 ) : 1000;
+
+   printf( "iterations: %lu, holders: %u\n\n", iterations, holders );
+   printf( "%-10s %8s %12s %10s %10s %10s %8s\n", "layout", "symbols", "RAM B/holder", "ns/op", "read B/op", "write B/op", "reads" );
+   for ( const uint32_t symbols : { 1, 10, 100 } ) {
+      for ( const layout& l : layouts ) run( l, iterations, holders, symbols );
+   }
+   return 0;
+}
@@ -0,0 +1,736 @@
+/**
+ * Native behavior tests of the wallet.sx balance engine.
+ *
+ * Compiles wallet.sx.cpp against the same host-side CDT stand-ins as the benchmark (`bench/eosio`)
+ * and asserts balances, registry counts & liabilities after scripted actions. An action expected
+ * to abort is run on a copy of the chain state, which is restored afterwards like a failed transaction;
+ * any other abort fails the test it escaped from and the remaining tests still run.
+ *
+ * usage: [CXXFLAGS="-DWALLET_STRICT_OPEN=1"] ./scripts/test_native.sh
+ */
+#include "../wallet.sx.cpp"
+
+#include <cstdio>
+#include <functional>
+#include <tuple>
+
+using namespace eosio;
+
+namespace {
+
+   const name self = "wallet.sx"_n;
+   const name eosio_token = "eosio.token"_n;
+   const name token_a = "token.a"_n;
+   const name token_b = "token.b"_n;
+
+   const symbol EOS{ "EOS", 4 };
+   const symbol ABC{ "ABC", 4 };
+   const symbol XYZ{ "XYZ", 4 };
+
+   uint32_t checks = 0;
+   uint32_t failures = 0;
+
+   void expect( const bool pred, const string& what )
+   {
+      checks++;
+      if ( pred ) return;
+      failures++;
+      printf( "FAIL %s\n", what.c_str() );
+   }
+
+   void expect_eq( const string& actual, const string& expected, const string& what )
+   {
+      expect( actual == expected, what + ": expected \"" + expected + "\", got \"" + actual + "\"" );
+   }
+
+   void expect_eq( const uint64_t actual, const uint64_t expected, const string& what )
+   {
+      expect_eq( std::to_string( actual ), std::to_string( expected ), what );
+   }
+
+   // runs an action that must abort with `message`, chain state is rolled back like a failed transaction
+   void expect_abort( const std::function<void()>& action, const string& message, const string& what )
+   {
+      const host::chain_state state = host::state();
+      const auto secondaries = host::secondaries();
+      string error = "(no abort)";
+      try {
+         action();
+      } catch ( const eosio_assert_exception& e ) {
+         error = e.what();
+      }
+      host::state() = state;
+      host::secondaries() = secondaries;
+      expect_eq( error, message, what );
+   }
+
+   // runs one test, an abort escaping it fails the test instead of ending the run
+   void run( const char* test, void (*body)() )
+   {
+      try {
+         body();
+      } catch ( const eosio_assert_exception& e ) {
+         expect( false, string( test ) + ": uncaught abort \"" + e.what() + "\"" );
+      }
+   }
+
+   sx::wallet wallet( const name first_receiver, const std::set<name>& auths )
+   {
+      host::set_action_context( self, first_receiver, auths );
+      return sx::wallet( self, first_receiver, datastream<const char*>( nullptr, 0 ) );
+   }
+
+   asset quantity( const int64_t amount, const symbol sym ) { return asset{ amount, sym }; }
+
+   void create_token( const name contract, const symbol sym )
+   {
+      host::set_action_context( contract, contract, {} );
+      token::stats _stats( contract, sym.code().raw() );
+      _stats.emplace( contract, [&]( auto& row ) {
+         row.supply = asset{ 0, sym };
+         row.max_supply = asset{ asset::max_amount, sym };
+         row.issuer = contract;
+      });
+   }
+
+   void setup( std::initializer_list<name> users )
+   {
+      host::reset_all();
+      auto& accounts = host::state().accounts;
+      accounts = { self, eosio_token, token_a, token_b };
+      accounts.insert( users );
+      create_token( eosio_token, EOS );
+      create_token( eosio_token, ABC );
+      create_token( eosio_token, XYZ );
+      create_token( token_a, ABC );
+      create_token( token_b, XYZ );
+
+      // users hold every token, `strict_open` withdrawals require their token contract balance
+      for ( const name user : users ) {
+         for ( const auto& [ contract, sym ] : { std::pair{ eosio_token, EOS }, { eosio_token, ABC }, { eosio_token, XYZ }, { token_a, ABC }, { token_b, XYZ } } ) {
+            host::set_action_context( contract, contract, {} );
+            token::accounts( contract, user.value ).emplace( user, [&]( auto& row ) { row.balance = asset{ 0, sym }; });
+         }
+      }
+   }
+
+   // a transfer to wallet.sx, own deposits open their balance first with `strict_open`
+   void deposit( const name from, const name contract, const asset quantity, const string& memo = "" )
+   {
+      if constexpr ( sx::policy::strict_open ) {
+         if ( memo.empty() ) wallet( self, { from } ).open( from, contract, quantity.symbol.code(), from );
+      }
+      wallet( contract, { from } ).on_transfer( from, self, quantity, memo );
+   }
+
+   // wallet balance as text, or the abort message when there is none
+   string balance( const name account, const name contract, const symbol sym )
+   {
+      try {
+         return sx::wallet::get_balance( self, account, contract, sym.code() ).to_string();
+      } catch ( const eosio_assert_exception& e ) {
+         return e.what();
+      }
+   }
+
+   // open balances counted by the account registry & the token contract holders
+   std::pair<uint32_t, uint32_t> registry( const name account, const name contract )
+   {
+      host::set_action_context( self, self, {} );
+      sx::wallet::accounts _accounts( self, self.value );
+      sx::wallet::holders _holders( self, contract.value );
+      const auto itr = _accounts.find( account.value );
+      const auto holder = _holders.find( account.value );
+      return { itr == _accounts.end() ? 0 : itr->balances, holder == _holders.end() ? 0 : holder->balances };
+   }
+
+   // token transfers sent inline since the last call, as "quantity@contract>to"
+   string transfers()
+   {
+      string sent;
+      for ( const host::inline_action& act : host::state().actions ) {
+         if ( act.action != "transfer"_n ) continue;
+         const auto [ from, to, quantity, memo ] = unpack<std::tuple<name, name, asset, string>>( act.data );
+         sent += quantity.to_string() + "@" + act.account.to_string() + ">" + to.to_string() + " ";
+      }
+      host::state().actions.clear();
+      return sent;
+   }
+
+   // RAM payer of a wallet.sx row
+   name payer( const name scope, const name table, const uint64_t primary_key )
+   {
+      const auto& rows = host::state().tables[{ self.value, scope.value, table.value }];
+      const auto row = rows.find( primary_key );
+      return row == rows.end() ? name{} : row->second.payer;
+   }
+
+   string liability( const name contract, const symbol sym )
+   {
+      sx::wallet::liabilities _liabilities( self, self.value );
+      const auto itr = _liabilities.find( sx::wallet::balance_key( contract, sym.code() ) );
+      return itr == _liabilities.end() ? "none" : itr->supply.to_string();
+   }
+
+   // compact entries of an `amounts` row as hex
+   string entries( const name account, const name contract )
+   {
+      host::set_action_context( self, self, {} );
+      sx::wallet::amounts _amounts( self, account.value );
+      const auto itr = _amounts.find( contract.value );
+      string hex;
+      if ( itr == _amounts.end() ) return hex;
+      for ( const char c : itr->entries ) {
+         char byte[3];
+         snprintf( byte, sizeof( byte ), "%02x", static_cast<uint8_t>( c ) );
+         hex += byte;
+      }
+      return hex;
+   }
+
+   void add_legacy( const name account, const name contract, const vector<asset>& balances )
+   {
+      host::set_action_context( self, self, {} );
+      sx::wallet::balances _balances( self, account.value );
+      _balances.emplace( self, [&]( auto& row ) {
+         row.contract = contract;
+         for ( const asset& balance : balances ) row.balances[ balance.symbol.code() ] = balance;
+      });
+   }
+
+   uint32_t legacy_rows( const name account )
+   {
+      sx::wallet::balances _balances( self, account.value );
+      return std::distance( _balances.begin(), _balances.end() );
+   }
+
+   void test_settle()
+   {
+      setup( { "alice"_n, "bob"_n, "carol"_n } );
+      deposit( "alice"_n, eosio_token, quantity( 1000, EOS ) );
+      deposit( "bob"_n, eosio_token, quantity( 100, EOS ) );
+
+      // bob pays carol before alice pays bob: overdrawn in leg order, covered once netted
+      host::counters() = {};
+      wallet( self, { "alice"_n, "bob"_n } ).settle( {
+         { "bob"_n, "carol"_n, eosio_token, quantity( 300, EOS ) },
+         { "alice"_n, "bob"_n, eosio_token, quantity( 250, EOS ) },
+         { "alice"_n, "bob"_n, eosio_token, quantity( 5, ABC ) },
+         { "bob"_n, "alice"_n, eosio_token, quantity( 5, ABC ) },
+      });
+      const uint64_t writes = host::counters().db_writes;
+      expect_eq( balance( "alice"_n, eosio_token, EOS ), "0.0750 EOS", "settle alice" );
+      expect_eq( balance( "bob"_n, eosio_token, EOS ), "0.0050 EOS", "settle bob" );
+      expect_eq( balance( "carol"_n, eosio_token, EOS ), "0.0300 EOS", "settle carol" );
+
+      // zero-net ABC legs create no balance: three EOS rows written, plus the registry & holder rows of carol
+      // and the ABC token cache row (first seen by this settlement)
+      expect_eq( writes, 6, "settle writes each dirty row once" );
+      expect_eq( balance( "alice"_n, eosio_token, ABC ), "no balance found", "zero-net leg creates no balance" );
+      expect_eq( balance( "bob"_n, eosio_token, ABC ), "no balance found", "zero-net leg creates no balance" );
+      expect_eq( registry( "carol"_n, eosio_token ).first, 1, "settle registers created balance" );
+      expect_eq( registry( "alice"_n, eosio_token ).first, 1, "zero-net leg is not registered" );
+      expect_eq( liability( eosio_token, EOS ), "0.1100 EOS", "settle keeps liabilities" );
+
+      expect_abort( [&]{
+         wallet( self, { "alice"_n, "bob"_n } ).settle( {
+            { "bob"_n, "carol"_n, eosio_token, quantity( 100, EOS ) },
+            { "alice"_n, "bob"_n, eosio_token, quantity( 40, EOS ) },
+         });
+      }, "overdrawn balance", "settle net overdraft" );
+      expect_abort( [&]{
+         wallet( self, { "bob"_n } ).settle( { { "alice"_n, "bob"_n, eosio_token, quantity( 1, EOS ) } } );
+      }, "missing required authority", "settle requires sender authority" );
+
+      // a sender netting positive creates its balance, its registry rows are billed to itself like a recipient's
+      setup( { "alice"_n, "bob"_n } );
+      deposit( "alice"_n, eosio_token, quantity( 10, EOS ) );
+      wallet( self, { "alice"_n, "bob"_n } ).settle( {
+         { "bob"_n, "alice"_n, eosio_token, quantity( 1, EOS ) },
+         { "alice"_n, "bob"_n, eosio_token, quantity( 2, EOS ) },
+      });
+      expect_eq( balance( "bob"_n, eosio_token, EOS ), "0.0001 EOS", "sender netting positive" );
+      const string sender = sx::policy::self_pays_ram ? "wallet.sx" : "bob";
+      expect_eq( payer( self, "accounts"_n, "bob"_n.value ).to_string(), sender, "sender registry billed to sender" );
+      expect_eq( payer( eosio_token, "holders"_n, "bob"_n.value ).to_string(), sender, "sender holder billed to sender" );
+      expect_eq( payer( "bob"_n, "amounts"_n, eosio_token.value ).to_string(), "wallet.sx", "amounts row billed to wallet.sx" );
+   }
+
+   void test_withdraw()
+   {
+      setup( { "alice"_n } );
+      deposit( "alice"_n, eosio_token, quantity( 100, EOS ) );
+
+      // withdrawn quantities are range checked before the balance is reduced
+      expect_abort( [&]{ wallet( self, { "alice"_n } ).withdraw( "alice"_n, eosio_token, quantity( 0, EOS ) ); },
+                    "quantity must be positive", "withdraw zero" );
+      expect_abort( [&]{ wallet( self, { "alice"_n } ).withdraw( "alice"_n, eosio_token, quantity( -100, EOS ) ); },
+                    "quantity must be positive", "withdraw negative" );
+      expect_abort( [&]{ wallet( self, { "alice"_n } ).withdraw( "alice"_n, eosio_token, quantity( 101, EOS ) ); },
+                    "overdrawn balance", "withdraw overdraft" );
+      wallet( self, { "alice"_n } ).withdraw( "alice"_n, eosio_token, quantity( 100, EOS ) );
+      expect_eq( balance( "alice"_n, eosio_token, EOS ), "0.0000 EOS", "withdraw whole balance" );
+   }
+   void test_withdrawbatch()
+   {
+      setup( { "alice"_n } );
+      deposit( "alice"_n, eosio_token, quantity( 100, EOS ) );
+      deposit( "alice"_n, eosio_token, quantity( 50, ABC ) );
+      deposit( "alice"_n, token_a, quantity( 30, ABC ) );
+      transfers();
+
+      // duplicate symbols are merged into one transfer, grouped by token contract
+      wallet( self, { "alice"_n } ).withdrawbatch( "alice"_n, {
+         { quantity( 10, EOS ), eosio_token },
+         { quantity( 5, ABC ), token_a },
+         { quantity( 20, EOS ), eosio_token },
+      });
+      expect_eq( transfers(), "0.0030 EOS@eosio.token>alice 0.0005 ABC@token.a>alice ", "withdrawbatch transfers" );
+      expect_eq( balance( "alice"_n, eosio_token, EOS ), "0.0070 EOS", "withdrawbatch merged EOS" );
+      expect_eq( balance( "alice"_n, eosio_token, ABC ), "0.0050 ABC", "withdrawbatch keeps other symbol" );
+      expect_eq( balance( "alice"_n, token_a, ABC ), "0.0025 ABC", "withdrawbatch other contract" );
+      expect_eq( liability( eosio_token, EOS ), "0.0070 EOS", "withdrawbatch reduces liabilities" );
+
+      expect_abort( [&]{ wallet( self, { "alice"_n } ).withdrawbatch( "alice"_n, {} ); },
+                    "quantities cannot be empty", "withdrawbatch empty" );
+      expect_abort( [&]{ wallet( self, { "alice"_n } ).withdrawbatch( "alice"_n, { { quantity( 0, EOS ), eosio_token } } ); },
+                    "quantity must be positive", "withdrawbatch zero" );
+      expect_abort( [&]{
+         wallet( self, { "alice"_n } ).withdrawbatch( "alice"_n, { { quantity( 40, EOS ), eosio_token }, { quantity( 40, EOS ), eosio_token } } );
+      }, "overdrawn balance", "withdrawbatch overdraft of merged duplicates" );
+      expect_abort( [&]{ wallet( self, { "alice"_n } ).withdrawbatch( "alice"_n, { { quantity( 1, XYZ ), token_b } } ); },
+                    "no account balance found", "withdrawbatch without balance" );
+   }
+   void test_move()
+   {
+      setup( { "alice"_n, "bob"_n, "carol"_n } );
+      deposit( "alice"_n, eosio_token, quantity( 100, EOS ) );
+      deposit( "alice"_n, eosio_token, quantity( 20, ABC ) );
+
+      // internal ledger only: liabilities unchanged, recipient registry billed to the sender
+      wallet( self, { "alice"_n } ).move( "alice"_n, "bob"_n, eosio_token, quantity( 30, EOS ), "" );
+      expect_eq( balance( "alice"_n, eosio_token, EOS ), "0.0070 EOS", "move debits sender" );
+      expect_eq( balance( "bob"_n, eosio_token, EOS ), "0.0030 EOS", "move credits recipient" );
+      expect_eq( liability( eosio_token, EOS ), "0.0100 EOS", "move keeps liabilities" );
+      expect( registry( "bob"_n, eosio_token ) == std::make_pair( 1u, 1u ), "move registers created balance" );
+      expect_eq( payer( self, "accounts"_n, "bob"_n.value ).to_string(), sx::policy::self_pays_ram ? "wallet.sx" : "alice", "move registry billed to sender" );
+
+      expect_abort( [&]{ wallet( self, { "alice"_n } ).move( "alice"_n, "alice"_n, eosio_token, quantity( 1, EOS ), "" ); },
+                    "cannot move to self", "move to self" );
+      expect_abort( [&]{ wallet( self, { "alice"_n } ).move( "alice"_n, "zed"_n, eosio_token, quantity( 1, EOS ), "" ); },
+                    "to account does not exist", "move to missing account" );
+      expect_abort( [&]{ wallet( self, { "alice"_n } ).move( "alice"_n, "bob"_n, eosio_token, quantity( 0, EOS ), "" ); },
+                    "must move positive quantity", "move zero" );
+      expect_abort( [&]{ wallet( self, { "alice"_n } ).move( "alice"_n, "bob"_n, eosio_token, quantity( 71, EOS ), "" ); },
+                    "overdrawn balance", "move overdraft" );
+      expect_abort( [&]{ wallet( self, { "bob"_n } ).move( "alice"_n, "bob"_n, eosio_token, quantity( 1, EOS ), "" ); },
+                    "missing required authority", "move requires sender authority" );
+
+      // debits are merged by symbol before the sender row is written
+      wallet( self, { "alice"_n } ).movemany( "alice"_n, eosio_token, {
+         { "bob"_n, quantity( 10, EOS ) },
+         { "carol"_n, quantity( 5, EOS ) },
+         { "bob"_n, quantity( 5, ABC ) },
+      }, "" );
+      expect_eq( balance( "alice"_n, eosio_token, EOS ), "0.0055 EOS", "movemany debits sender" );
+      expect_eq( balance( "alice"_n, eosio_token, ABC ), "0.0015 ABC", "movemany debits each symbol" );
+      expect_eq( balance( "bob"_n, eosio_token, EOS ), "0.0040 EOS", "movemany credits recipient" );
+      expect_eq( balance( "bob"_n, eosio_token, ABC ), "0.0005 ABC", "movemany credits other symbol" );
+      expect_eq( balance( "carol"_n, eosio_token, EOS ), "0.0005 EOS", "movemany credits second recipient" );
+
+      expect_abort( [&]{ wallet( self, { "alice"_n } ).movemany( "alice"_n, eosio_token, {}, "" ); },
+                    "recipients cannot be empty", "movemany empty" );
+      expect_abort( [&]{
+         wallet( self, { "alice"_n } ).movemany( "alice"_n, eosio_token, { { "bob"_n, quantity( 30, EOS ) }, { "carol"_n, quantity( 30, EOS ) } }, "" );
+      }, "overdrawn balance", "movemany overdraft of merged debits" );
+   }
+   // inline `deposit` notifications sent since the last call
+   uint32_t notifications()
+   {
+      uint32_t sent = 0;
+      for ( const host::inline_action& act : host::state().actions ) sent += act.account == self && act.action == "deposit"_n;
+      host::state().actions.clear();
+      return sent;
+   }
+
+   // `deposits` ring buffer as "slot: quantity@contract xcount"
+   string deposit_log()
+   {
+      host::set_action_context( self, self, {} );
+      sx::wallet::deposits _deposits( self, self.value );
+      string log;
+      for ( const auto& row : _deposits ) {
+         log += std::to_string( row.id ) + ":";
+         for ( const auto& summary : row.deposits ) log += " " + summary.quantity.to_string() + " x" + std::to_string( summary.count );
+         log += "; ";
+      }
+      return log;
+   }
+
+   void test_notify()
+   {
+      // the host clock starts on an even block slot (ring buffer slot 0 of 2)
+      setup( { "alice"_n } );
+      expect_eq( current_block_time().slot % 2, 0, "first block slot" );
+
+      // inline by default, nothing at all without the `notify` policy
+      deposit( "alice"_n, eosio_token, quantity( 1, EOS ) );
+      expect_eq( notifications(), sx::policy::notify ? 1 : 0, "inline deposit notification" );
+
+      wallet( self, { self } ).setsettings( sx::wallet::params{ "none"_n, 2 } );
+      deposit( "alice"_n, eosio_token, quantity( 1, EOS ) );
+      expect_eq( notifications(), 0, "no deposit notification" );
+      expect_eq( deposit_log(), "", "no deposit log" );
+
+      // aggregated per block & token into a ring buffer of `log_size` slots
+      wallet( self, { self } ).setsettings( sx::wallet::params{ "aggregated"_n, 2 } );
+      deposit( "alice"_n, eosio_token, quantity( 2, EOS ) );
+      deposit( "alice"_n, eosio_token, quantity( 3, EOS ) );
+      deposit( "alice"_n, token_a, quantity( 4, ABC ) );
+      host::state().now_us += 500000;
+      deposit( "alice"_n, eosio_token, quantity( 5, EOS ) );
+      expect_eq( notifications(), 0, "aggregated sends no notification" );
+      const string log = "0: 0.0005 EOS@eosio.token x2 0.0004 ABC@token.a x1; 1: 0.0005 EOS@eosio.token x1; ";
+      expect_eq( deposit_log(), sx::policy::notify ? log : "", "aggregated deposit log" );
+
+      // a wrapped slot is overwritten by its new block
+      host::state().now_us += 500000;
+      deposit( "alice"_n, eosio_token, quantity( 6, EOS ) );
+      const string wrapped = "0: 0.0006 EOS@eosio.token x1; 1: 0.0005 EOS@eosio.token x1; ";
+      expect_eq( deposit_log(), sx::policy::notify ? wrapped : "", "aggregated slot wraps around" );
+
+      expect_abort( [&]{ wallet( self, { self } ).setsettings( sx::wallet::params{ "always"_n, 2 } ); },
+                    "notify must be `inline`, `none` or `aggregated`", "setsettings mode" );
+      expect_abort( [&]{ wallet( self, { self } ).setsettings( sx::wallet::params{ "inline"_n, 0 } ); },
+                    "log_size must be positive", "setsettings log_size" );
+   }
+   void test_memo_routing()
+   {
+      setup( { "alice"_n, "bob"_n, "carol"_n } );
+      deposit( "alice"_n, eosio_token, quantity( 1, EOS ) );
+      wallet( self, { "bob"_n } ).open( "bob"_n, eosio_token, EOS.code(), "bob"_n );
+
+      // `<account>[:<tags>]` credits an opened balance of the memo account
+      deposit( "alice"_n, eosio_token, quantity( 10, EOS ), "bob" );
+      deposit( "alice"_n, eosio_token, quantity( 20, EOS ), "bob:order-42" );
+      expect_eq( balance( "bob"_n, eosio_token, EOS ), "0.0030 EOS", "memo routed deposits" );
+      expect_abort( [&]{ deposit( "alice"_n, eosio_token, quantity( 1, EOS ), "carol" ); },
+                    "account must have `open` balance", "memo account without open balance" );
+
+      // anything else credits the sender
+      deposit( "alice"_n, eosio_token, quantity( 2, EOS ), "zed" );
+      deposit( "alice"_n, eosio_token, quantity( 3, EOS ), "Hello world!" );
+      deposit( "alice"_n, eosio_token, quantity( 4, EOS ), "alice:self" );
+      for ( const string memo : { "bobbobbobbob1", "bob.", ":bob", "BOB" } ) deposit( "alice"_n, eosio_token, quantity( 10, EOS ), memo );
+      expect_eq( balance( "alice"_n, eosio_token, EOS ), "0.0050 EOS", "unrouted deposits credit sender" );
+      expect_eq( balance( "bob"_n, eosio_token, EOS ), "0.0030 EOS", "invalid memo accounts are not routed" );
+      expect_eq( liability( eosio_token, EOS ), "0.0080 EOS", "routed deposits added to liabilities" );
+
+   }
+   void test_liabilities()
+   {
+      setup( { "alice"_n, "bob"_n } );
+      add_legacy( "alice"_n, eosio_token, { quantity( 300, EOS ), quantity( 0, ABC ) } );
+
+      // legacy balances join the liabilities when they are moved
+      deposit( "alice"_n, eosio_token, quantity( 100, EOS ) );
+      expect_eq( liability( eosio_token, EOS ), "0.0400 EOS", "legacy balance added to liabilities" );
+
+      // solvency waits until the token is seeded
+      host::set_action_context( eosio_token, eosio_token, {} );
+      token::accounts( eosio_token, self.value ).emplace( self, [&]( auto& row ) { row.balance = quantity( 400, EOS ); });
+      expect_abort( [&]{ wallet( self, {} ).solvency( eosio_token, EOS.code() ); },
+                    "liabilities are not seeded (see `setliability`)", "solvency before seeding" );
+      wallet( self, { self } ).setliability( eosio_token, EOS.code() );
+      const auto seeded = wallet( self, {} ).solvency( eosio_token, EOS.code() );
+      expect( seeded.solvent && seeded.liabilities == quantity( 400, EOS ) && seeded.holdings == quantity( 400, EOS ), "solvent once seeded" );
+      expect_abort( [&]{ wallet( self, { self } ).setliability( eosio_token, EOS.code() ); },
+                    "liabilities already seeded", "setliability twice" );
+
+      wallet( self, { "alice"_n } ).withdraw( "alice"_n, eosio_token, quantity( 50, EOS ) );
+      expect_eq( liability( eosio_token, EOS ), "0.0350 EOS", "withdraw reduces liabilities" );
+
+      // the stand-ins do not execute transfers, wallet holdings stay at 0.0400 EOS
+      deposit( "bob"_n, eosio_token, quantity( 100, EOS ) );
+      expect( !wallet( self, {} ).solvency( eosio_token, EOS.code() ).solvent, "insolvent when liabilities exceed holdings" );
+
+      // tokens without balances are seeded at zero
+      wallet( self, { self } ).setliability( token_b, XYZ.code() );
+      expect( wallet( self, {} ).solvency( token_b, XYZ.code() ).solvent, "token seeded at zero" );
+      expect_abort( [&]{ wallet( self, {} ).solvency( token_a, ABC.code() ); }, "no liabilities found", "solvency of unknown token" );
+   }
+
+   void test_holders()
+   {
+      setup( { "alice"_n, "bob"_n, "carol"_n } );
+      for ( const name user : { "carol"_n, "alice"_n, "bob"_n } ) {
+         host::state().now_us += 1000000;
+         deposit( user, eosio_token, quantity( 1, EOS ) );
+      }
+      auto page = wallet( self, {} ).getholders( name{}, 0, 1 );
+      expect( page.holders.size() == 1 && page.holders[0].account == "carol"_n, "holders by first seen" );
+
+      // next account of the page leaves the registry, the cursor still resumes after it
+      wallet( self, { "alice"_n } ).withdraw( "alice"_n, eosio_token, quantity( 1, EOS ) );
+      wallet( self, { "alice"_n } ).close( "alice"_n, eosio_token, EOS.code() );
+      page = wallet( self, {} ).getholders( name{}, page.next, 1 );
+      expect( page.holders.size() == 1 && page.holders[0].account == "bob"_n, "holders cursor survives removed account" );
+      expect( page.next == 0, "holders last page" );
+
+      // token contract holders by account name
+      deposit( "carol"_n, eosio_token, quantity( 1, ABC ) );
+      page = wallet( self, {} ).getholders( eosio_token, 0, 1 );
+      expect( page.holders.size() == 1 && page.holders[0].account == "bob"_n && page.next == "carol"_n.value, "token holders page" );
+      page = wallet( self, {} ).getholders( eosio_token, page.next, 10 );
+      expect( page.holders.size() == 1 && page.holders[0].balances == 2 && page.next == 0, "token holder balances" );
+      expect_abort( [&]{ wallet( self, {} ).getholders( name{}, 0, 0 ); }, "limit must be between 1 and 1000", "holders limit" );
+   }
+
+   void test_migrate()
+   {
+      setup( { "alice"_n, "bob"_n } );
+      add_legacy( "alice"_n, eosio_token, { quantity( 10, EOS ), quantity( 20, XYZ ) } );
+      add_legacy( "alice"_n, token_a, { quantity( 30, ABC ) } );
+      add_legacy( "alice"_n, token_b, { quantity( 0, XYZ ) } );
+      add_legacy( "bob"_n, token_a, { quantity( 40, ABC ) } );
+      wallet( self, { self } ).queuemigrate( { "alice"_n, "bob"_n } );
+
+      // budget runs out mid-way through alice, next call resumes her remaining row
+      auto result = wallet( self, {} ).migrate( 2 );
+      expect( result.rows == 2 && !result.done, "migrate first budget" );
+      expect_eq( legacy_rows( "alice"_n ), 1, "migrate leaves remaining legacy row" );
+      result = wallet( self, {} ).migrate( 2 );
+      expect( result.rows == 2 && !result.done, "migrate resumes" );
+
+      // a budget used up exactly cannot tell whether rows are left, the next call completes the queue
+      result = wallet( self, {} ).migrate( 2 );
+      expect( result.rows == 0 && result.done, "migrate done" );
+      expect_eq( legacy_rows( "alice"_n ) + legacy_rows( "bob"_n ), 0, "migrate moves every legacy row" );
+
+      expect_eq( balance( "alice"_n, eosio_token, XYZ ), "0.0020 XYZ", "migrated balance" );
+      expect_eq( balance( "alice"_n, token_b, XYZ ), "0.0000 XYZ", "migrated zero balance" );
+      expect_eq( registry( "alice"_n, token_a ).first, 4, "migrated balances registered" );
+      expect_eq( registry( "bob"_n, token_a ).second, 1, "migrated holder registered" );
+      expect_eq( liability( token_a, ABC ), "0.0070 ABC", "migrated balances added to liabilities" );
+      expect_abort( [&]{ wallet( self, {} ).migrate( 0 ); }, "max_rows must be positive", "migrate budget" );
+   }
+
+   void test_queued_withdrawals()
+   {
+      setup( { "alice"_n } );
+      deposit( "alice"_n, eosio_token, quantity( 100, EOS ) );
+      deposit( "alice"_n, eosio_token, quantity( 100, ABC ) );
+      deposit( "alice"_n, token_a, quantity( 100, ABC ) );
+
+      // queued withdrawals are debited at once & summed per token until flushed
+      wallet( self, { "alice"_n } ).qwithdraw( "alice"_n, eosio_token, quantity( 10, EOS ) );
+      wallet( self, { "alice"_n } ).qwithdraw( "alice"_n, eosio_token, quantity( 20, EOS ) );
+      wallet( self, { "alice"_n } ).qwithdraw( "alice"_n, eosio_token, quantity( 40, ABC ) );
+      wallet( self, { "alice"_n } ).qwithdraw( "alice"_n, token_a, quantity( 5, ABC ) );
+      expect_eq( balance( "alice"_n, eosio_token, EOS ), "0.0070 EOS", "qwithdraw debits balance" );
+      expect_eq( liability( eosio_token, EOS ), "0.0100 EOS", "queued withdrawal still owed" );
+      expect_abort( [&]{ wallet( self, { "alice"_n } ).qwithdraw( "alice"_n, eosio_token, quantity( 71, EOS ) ); },
+                    "overdrawn balance", "qwithdraw overdraft" );
+      expect_abort( [&]{ wallet( self, { "alice"_n } ).qwithdraw( "alice"_n, eosio_token, quantity( 0, EOS ) ); },
+                    "quantity must be positive", "qwithdraw zero" );
+
+      wallet( self, { "alice"_n } ).qcancel( "alice"_n, eosio_token, ABC.code() );
+      expect_eq( balance( "alice"_n, eosio_token, ABC ), "0.0100 ABC", "qcancel credits back" );
+      expect_abort( [&]{ wallet( self, { "alice"_n } ).qcancel( "alice"_n, eosio_token, ABC.code() ); },
+                    "no pending withdrawal found", "qcancel removes pending row" );
+
+      // anyone flushes up to `max` rows of an account, one transfer per token
+      transfers();
+      wallet( self, {} ).flush( "alice"_n, 1 );
+      expect_eq( transfers(), "0.0030 EOS@eosio.token>alice ", "flush sends summed quantity" );
+      expect_eq( liability( eosio_token, EOS ), "0.0070 EOS", "flush reduces liabilities" );
+      wallet( self, {} ).flush( "alice"_n, 10 );
+      expect_eq( transfers(), "0.0005 ABC@token.a>alice ", "flush resumes with remaining rows" );
+      expect_abort( [&]{ wallet( self, {} ).flush( "alice"_n, 10 ); }, "no pending withdrawals", "flush empties queue" );
+      expect_abort( [&]{ wallet( self, {} ).flush( "alice"_n, 0 ); }, "max must be positive", "flush max" );
+   }
+
+   void test_compact_balances()
+   {
+      setup( { "alice"_n, "bob"_n, "carol"_n } );
+
+      // entries sorted by symbol code: varuint symbol code, varuint amount << 1 | opened
+      deposit( "alice"_n, eosio_token, quantity( 10000, EOS ) );
+      expect_eq( entries( "alice"_n, eosio_token ), sx::policy::strict_open ? "c59ecd02a19c01" : "c59ecd02a09c01", "compact entry" );
+      wallet( self, { "alice"_n } ).open( "alice"_n, eosio_token, ABC.code(), "alice"_n );
+      expect_eq( entries( "alice"_n, eosio_token ), string( "c1848d0201" ) + ( sx::policy::strict_open ? "c59ecd02a19c01" : "c59ecd02a09c01" ), "opened entry sorted first" );
+
+      // `amounts` rows are billed to wallet.sx, registry rows to `ram_payer`
+      wallet( self, { "carol"_n } ).open( "bob"_n, eosio_token, EOS.code(), "carol"_n );
+      expect_eq( payer( "bob"_n, "amounts"_n, eosio_token.value ).to_string(), "wallet.sx", "amounts row billed to wallet.sx" );
+      expect_eq( payer( self, "accounts"_n, "bob"_n.value ).to_string(), "carol", "registry billed to ram_payer" );
+      expect_eq( payer( eosio_token, "holders"_n, "bob"_n.value ).to_string(), "carol", "holder billed to ram_payer" );
+
+      // evicted tokens are decoded with the token contract precision
+      wallet( self, { self } ).evicttoken( eosio_token, EOS.code() );
+      expect_eq( balance( "alice"_n, eosio_token, EOS ), "1.0000 EOS", "balance of evicted token" );
+      expect_abort( [&]{ wallet( self, { self } ).evicttoken( eosio_token, EOS.code() ); }, "token is not cached", "evict twice" );
+   }
+
+   void test_legacy_balances()
+   {
+      setup( { "alice"_n, "bob"_n } );
+      add_legacy( "alice"_n, eosio_token, { quantity( 300, EOS ), quantity( 0, ABC ) } );
+
+      // legacy rows are read in place until first touched
+      expect_eq( balance( "alice"_n, eosio_token, EOS ), "0.0300 EOS", "legacy read" );
+      expect_eq( registry( "alice"_n, eosio_token ).first, 0, "legacy balances are not registered" );
+
+      deposit( "alice"_n, eosio_token, quantity( 100, EOS ) );
+      expect_eq( legacy_rows( "alice"_n ), 0, "legacy row moved on first deposit" );
+      expect_eq( balance( "alice"_n, eosio_token, EOS ), "0.0400 EOS", "legacy EOS moved" );
+      expect_eq( balance( "alice"_n, eosio_token, ABC ), "0.0000 ABC", "legacy zero ABC moved" );
+      expect( registry( "alice"_n, eosio_token ) == std::make_pair( 2u, 2u ), "moved balances registered" );
+
+      // moved legacy balances count as opened: kept by `sweep` & accept memo deposits
+      wallet( self, {} ).sweep( 100 );
+      expect_eq( balance( "alice"_n, eosio_token, ABC ), "0.0000 ABC", "sweep keeps legacy zero balance" );
+      deposit( "bob"_n, eosio_token, quantity( 7, ABC ), "alice" );
+      expect_eq( balance( "alice"_n, eosio_token, ABC ), "0.0007 ABC", "memo deposit to moved balance" );
+   }
+
+   void test_portfolio()
+   {
+      setup( { "alice"_n } );
+      deposit( "alice"_n, token_b, quantity( 1, XYZ ) );
+      deposit( "alice"_n, eosio_token, quantity( 2, XYZ ) );
+      deposit( "alice"_n, eosio_token, quantity( 3, EOS ) );
+      deposit( "alice"_n, eosio_token, quantity( 4, ABC ) );
+      add_legacy( "alice"_n, token_a, { quantity( 5, ABC ) } );
+
+      // pages of 2 over both layouts, ordered by contract & symbol code
+      string listed;
+      uint128_t cursor = 0;
+      uint32_t pages = 0;
+      do {
+         const auto page = wallet( self, {} ).getportfolio( "alice"_n, cursor, 2, name{}, symbol_code{} );
+         for ( const auto& balance : page.balances ) listed += balance.quantity.to_string() + "@" + balance.contract.to_string() + " ";
+         cursor = page.next;
+         pages++;
+      } while ( cursor && pages < 10 );
+      expect_eq( listed, "0.0004 ABC@eosio.token 0.0003 EOS@eosio.token 0.0002 XYZ@eosio.token 0.0005 ABC@token.a 0.0001 XYZ@token.b ", "portfolio pages" );
+      expect_eq( pages, 3, "portfolio page count" );
+
+      const auto filtered = wallet( self, {} ).getportfolio( "alice"_n, 0, 10, name{}, XYZ.code() );
+      expect_eq( filtered.balances.size(), 2, "portfolio symbol filter" );
+      const auto legacy = wallet( self, {} ).getportfolio( "alice"_n, 0, 10, token_a, symbol_code{} );
+      expect( legacy.balances.size() == 1 && legacy.balances[0].quantity == quantity( 5, ABC ), "portfolio contract filter on legacy row" );
+
+      // evicted tokens are listed with the token contract precision
+      wallet( self, { self } ).evicttoken( eosio_token, EOS.code() );
+      const auto evicted = wallet( self, {} ).getportfolio( "alice"_n, 0, 10, eosio_token, EOS.code() );
+      expect( evicted.balances.size() == 1 && evicted.balances[0].quantity == quantity( 3, EOS ), "portfolio of evicted token" );
+      expect_abort( [&]{ wallet( self, {} ).getportfolio( "alice"_n, 0, 1001, name{}, symbol_code{} ); },
+                    "limit must be between 1 and 1000", "portfolio limit" );
+   }
+
+   void test_sweep()
+   {
+      // dormant balances created by moves (deposits open them with `strict_open`)
+      setup( { "alice"_n, "bob"_n, "carol"_n, "dave"_n, "erin"_n } );
+      deposit( "erin"_n, eosio_token, quantity( 100, EOS ) );
+      deposit( "erin"_n, eosio_token, quantity( 100, XYZ ) );
+      deposit( "erin"_n, token_a, quantity( 100, ABC ) );
+      for ( const name user : { "alice"_n, "bob"_n, "carol"_n } ) {
+         wallet( self, { "erin"_n } ).movemany( "erin"_n, eosio_token, { { user, quantity( 10, EOS ) }, { user, quantity( 10, XYZ ) } }, "" );
+         wallet( self, { "erin"_n } ).move( "erin"_n, user, token_a, quantity( 10, ABC ), "" );
+         wallet( self, { user } ).withdraw( user, eosio_token, quantity( 10, EOS ) );
+         wallet( self, { user } ).withdraw( user, token_a, quantity( 10, ABC ) );
+      }
+      wallet( self, { "dave"_n } ).open( "dave"_n, eosio_token, EOS.code(), "dave"_n );
+
+      // one registry or balance row per call, every call makes progress
+      uint32_t calls = 0;
+      uint32_t rows = 0;
+      for ( bool done = false; !done && calls < 100; calls++ ) {
+         const auto result = wallet( self, {} ).sweep( 1 );
+         rows += result.rows;
+         done = result.done;
+      }
+      expect( calls > 4, "sweep resumes across budgets" );
+      expect_eq( rows, 6, "sweep erases zero balances" );
+      expect_eq( balance( "erin"_n, eosio_token, EOS ), "0.0070 EOS", "sweep keeps non-zero balance" );
+      for ( const name user : { "alice"_n, "bob"_n, "carol"_n } ) {
+         expect_eq( balance( user, eosio_token, EOS ), "no balance found", "swept zero entry" );
+         expect_eq( balance( user, eosio_token, XYZ ), "0.0010 XYZ", "sweep keeps non-zero entry" );
+         expect_eq( balance( user, token_a, ABC ), "no account balance found", "swept emptied row" );
+         expect( registry( user, eosio_token ) == std::make_pair( 1u, 1u ), "sweep unregisters balances" );
+         expect_eq( registry( user, token_a ).second, 0, "sweep unregisters holder" );
+      }
+
+      // opened balances are kept and still accept memo deposits
+      expect_eq( balance( "dave"_n, eosio_token, EOS ), "0.0000 EOS", "sweep keeps opened balance" );
+      deposit( "erin"_n, eosio_token, quantity( 3, EOS ), "dave" );
+      expect_eq( balance( "dave"_n, eosio_token, EOS ), "0.0003 EOS", "memo deposit after sweep" );
+   }
+
+   // `stats` windows of a token as "volume/deposits/withdrawals/created/erased"
+   string token_stats( const name contract, const symbol sym )
+   {
+      string windows;
+      for ( const auto& row : wallet( self, {} ).getstats( contract, sym.code() ) ) {
+         windows += std::to_string( row.volume ) + "/" + std::to_string( row.deposits ) + "/" + std::to_string( row.withdrawals )
+                  + "/" + std::to_string( row.created ) + "/" + std::to_string( row.erased ) + " ";
+      }
+      return windows;
+   }
+
+   void test_stats()
+   {
+      setup( { "alice"_n } );
+      deposit( "alice"_n, eosio_token, quantity( 10, EOS ) );
+      deposit( "alice"_n, eosio_token, quantity( 5, EOS ) );
+      wallet( self, { "alice"_n } ).withdraw( "alice"_n, eosio_token, quantity( 3, EOS ) );
+      wallet( self, { "alice"_n } ).withdrawbatch( "alice"_n, { { quantity( 2, EOS ), eosio_token }, { quantity( 1, EOS ), eosio_token } } );
+
+      // counters only exist with the `stats` policy (`-DWALLET_STATS=1`)
+      if constexpr ( !sx::policy::stats ) {
+         expect_eq( token_stats( eosio_token, EOS ), "", "no stats without policy" );
+         return;
+      }
+      expect_eq( token_stats( eosio_token, EOS ), "21/2/2/1/0 ", "deposit & withdraw counters" );
+
+      // one row per window, listed in time order
+      host::state().now_us += int64_t( sx::policy::stats_window ) * 1000000;
+      wallet( self, { "alice"_n } ).withdraw( "alice"_n, eosio_token, quantity( 9, EOS ) );
+      wallet( self, { "alice"_n } ).close( "alice"_n, eosio_token, EOS.code() );
+      wallet( self, { "alice"_n } ).open( "alice"_n, eosio_token, ABC.code(), "alice"_n );
+      expect_eq( token_stats( eosio_token, EOS ), "21/2/2/1/0 9/0/1/0/1 ", "stats windows" );
+      expect_eq( token_stats( eosio_token, ABC ), "0/0/0/1/0 ", "open counter" );
+
+      // queued withdrawals count once flushed, one withdrawal per summed transfer
+      deposit( "alice"_n, eosio_token, quantity( 10, ABC ) );
+      wallet( self, { "alice"_n } ).qwithdraw( "alice"_n, eosio_token, quantity( 4, ABC ) );
+      wallet( self, { "alice"_n } ).qwithdraw( "alice"_n, eosio_token, quantity( 2, ABC ) );
+      expect_eq( token_stats( eosio_token, ABC ), "10/1/0/1/0 ", "queued withdrawal not yet counted" );
+      wallet( self, {} ).flush( "alice"_n, 10 );
+      expect_eq( token_stats( eosio_token, ABC ), "16/1/1/1/0 ", "flushed withdrawal counted" );
+   }
+}
+
+int main()
+{
+   run( "settle", test_settle );
+   run( "withdraw", test_withdraw );
+   run( "withdrawbatch", test_withdrawbatch );
+   run( "move", test_move );
+   run( "notify", test_notify );
+   run( "memo routing", test_memo_routing );
+   run( "liabilities", test_liabilities );
+   run( "holders", test_holders );
+   run( "migrate", test_migrate );
+   run( "queued withdrawals", test_queued_withdrawals );
+   run( "compact balances", test_compact_balances );
+   run( "legacy balances", test_legacy_balances );
+   run( "portfolio", test_portfolio );
+   run( "sweep", test_sweep );
+   run( "stats", test_stats );
+
+   printf( "%u checks, %u failed\n", checks, failures );
+   return failures ? 1 : 0;
+}
@@ -23,28 +23,28 @@ public:
 	[[eosio::action]]
 	void withdraw( const name account, const name contract, const asset quantity )
 	{
-		walletSx::withdraw_action withdraw( "wallet.sx"_n, { account, "active"_n });
+		sx::wallet::withdraw_action withdraw( "wallet.sx"_n, { account, "active"_n });
 	    withdraw.send( account, contract, quantity );
 	}
 
 	[[eosio::action]]
 	void move( const name from, const name to, const name contract, const asset quantity, const string memo )
 	{
-		walletSx::move_action move( "wallet.sx"_n, { from, "active"_n });
+		sx::wallet::move_action move( "wallet.sx"_n, { from, "active"_n });
 	    move.send( from, to, contract, quantity, memo );
 	}
 
 	[[eosio::action]]
 	void internal( const name from, const name contract, const asset quantity )
 	{
-		walletSx::move_action move( "wallet.sx"_n, { "wallet.sx"_n, "active"_n });
+		sx::wallet::move_action move( "wallet.sx"_n, { "wallet.sx"_n, "active"_n });
 	    move.send( from, get_self(), contract, quantity, "internal transfer" );
 	}
 
 	[[eosio::action]]
 	void balance( const name account, const name contract, const symbol_code symcode )
 	{
-		const asset balance = walletSx::get_balance("wallet.sx"_n, account, contract, symcode );
+		const asset balance = sx::wallet::get_balance("wallet.sx"_n, account, contract, symcode );
 		print( balance.to_string() );
 	}
 };
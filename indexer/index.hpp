@@ -0,0 +1,322 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * Memory-mapped balance index of wallet.sx.
+ *
+ * The file is a header followed by an open-addressing hash table of fixed-size entries keyed by
+ * (account, contract, symcode). Entries hold absolute balances, so re-applying the deltas of a block
+ * is idempotent: after a crash, syncing resumes from the last committed block and replays forward.
+ *
+ * Lookups by account and by token (contract, symcode) go through in-memory secondary indexes,
+ * rebuilt from the mapped table when the file is opened.
+ *
+ * Token symbols of the `tokens` cache are stored as entries of account 0 (`table_tokens`), compact
+ * `amounts` entries only carry the symbol code and take the precision from them.
+ */
+namespace indexer {
+
+    enum : uint8_t { slot_empty = 0, slot_used = 1, slot_erased = 2 };
+    enum : uint8_t { table_balances = 1, table_amounts = 2, table_tokens = 3 };
+
+    struct entry {
+        uint64_t        account;
+        uint64_t        contract;
+        uint64_t        symcode;
+        uint64_t        primary_key;            // row primary key (`tokens` id, `amounts` & legacy `balances` contract)
+        int64_t         amount;
+        uint32_t        block_num;              // block of the last update
+        uint8_t         precision;
+        uint8_t         state;
+        uint8_t         table;
+        uint8_t         reserved;
+    };
+    static_assert( sizeof( entry ) == 48, "entry layout must stay fixed" );
+
+    struct header {
+        static constexpr uint64_t magic_value = 0x78646e692e78732eull; // ".sx.indx"
+        static constexpr uint32_t version_value = 3;
+
+        uint64_t                magic;
+        uint32_t                version;
+        uint32_t                committed_block;
+        std::array<char, 32>    committed_id;
+        uint64_t                capacity;
+        uint64_t                size;
+        uint64_t                erased;
+        char                    reserved[4096 - 72];
+    };
+    static_assert( sizeof( header ) == 4096, "header must fill one page" );
+
+    class index {
+    public:
+        explicit index( std::string path, uint64_t capacity = 1 << 20, bool read_only = false )
+            : _path( std::move( path ) ), _read_only( read_only )
+        {
+            map_file( _path, capacity );
+            rebuild_secondary();
+        }
+
+        ~index() { unmap(); }
+
+        index( const index& ) = delete;
+        index& operator=( const index& ) = delete;
+
+        uint32_t committed_block() const { return _header->committed_block; }
+        uint64_t size() const { return _header->size; }
+        uint64_t capacity() const { return _header->capacity; }
+
+        const entry* find( uint64_t account, uint64_t contract, uint64_t symcode ) const
+        {
+            const uint64_t slot = probe( account, contract, symcode );
+            return _entries[slot].state == slot_used ? &_entries[slot] : nullptr;
+        }
+
+        std::vector<const entry*> by_account( uint64_t account ) const
+        {
+            return collect( _by_account, account );
+        }
+
+        std::vector<const entry*> by_token( uint64_t contract, uint64_t symcode ) const
+        {
+            return collect( _by_token, token_key( contract, symcode ) );
+        }
+
+        // cached token symbol of a token contract & symbol code
+        const entry* token( uint64_t contract, uint64_t symcode ) const
+        {
+            const entry* e = find( 0, contract, symcode );
+            return e && e->table == table_tokens ? e : nullptr;
+        }
+
+        /**
+         * Insert or overwrite a balance; `amounts` entries take precedence over legacy `balances` entries.
+         */
+        void upsert( const entry& value )
+        {
+            reserve( 1 );
+            const uint64_t slot = probe( value.account, value.contract, value.symcode );
+            entry& e = _entries[slot];
+            if ( e.state == slot_used ) {
+                if ( rank( e.table ) > rank( value.table ) ) return;
+                const uint8_t state = e.state;
+                e = value;
+                e.state = state;
+                return;
+            }
+            if ( e.state == slot_erased ) _header->erased--;
+            e = value;
+            e.state = slot_used;
+            _header->size++;
+            link( slot );
+        }
+
+        void erase( const entry* value )
+        {
+            const uint64_t slot = value - _entries;
+            unlink( slot );
+            _entries[slot].state = slot_erased;
+            _header->size--;
+            _header->erased++;
+        }
+
+        // erase every entry of `account` matching the predicate
+        template <typename F>
+        void erase_if( uint64_t account, F&& pred )
+        {
+            for ( const entry* e : by_account( account ) ) {
+                if ( pred( *e ) ) erase( e );
+            }
+        }
+
+        /**
+         * Flush entries to disk, then record `block_num` as fully applied.
+         */
+        void commit( uint32_t block_num, const std::array<char, 32>& block_id )
+        {
+            sync();
+            _header->committed_block = block_num;
+            _header->committed_id = block_id;
+            if ( msync( _header, sizeof( header ), MS_SYNC ) ) throw std::runtime_error( "index: msync failed" );
+        }
+
+    private:
+        std::string                                                     _path;
+        bool                                                            _read_only;
+        int                                                             _fd = -1;
+        size_t                                                          _mapped = 0;
+        header*                                                         _header = nullptr;
+        entry*                                                          _entries = nullptr;
+        std::unordered_map<uint64_t, std::unordered_set<uint64_t>>      _by_account;
+        std::unordered_map<uint64_t, std::unordered_set<uint64_t>>      _by_token;
+
+        // layout precedence of entries with the same key, newest layout first
+        static int rank( uint8_t table )
+        {
+            return table == table_amounts ? 1 : 0;
+        }
+
+        static uint64_t mix( uint64_t x )
+        {
+            x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ull;
+            x ^= x >> 27; x *= 0x94d049bb133111ebull;
+            return x ^ ( x >> 31 );
+        }
+
+        static uint64_t token_key( uint64_t contract, uint64_t symcode )
+        {
+            return mix( contract ) ^ symcode;
+        }
+
+        static uint64_t hash( uint64_t account, uint64_t contract, uint64_t symcode )
+        {
+            return mix( account ^ mix( contract ^ mix( symcode ) ) );
+        }
+
+        // slot holding the key, or the first reusable slot on its probe sequence
+        uint64_t probe( uint64_t account, uint64_t contract, uint64_t symcode ) const
+        {
+            const uint64_t mask = _header->capacity - 1;
+            uint64_t slot = hash( account, contract, symcode ) & mask;
+            uint64_t reusable = UINT64_MAX;
+            for ( ;; slot = ( slot + 1 ) & mask ) {
+                const entry& e = _entries[slot];
+                if ( e.state == slot_empty ) return reusable != UINT64_MAX ? reusable : slot;
+                if ( e.state == slot_erased ) {
+                    if ( reusable == UINT64_MAX ) reusable = slot;
+                    continue;
+                }
+                if ( e.account == account && e.contract == contract && e.symcode == symcode ) return slot;
+            }
+        }
+
+        std::vector<const entry*> collect( const std::unordered_map<uint64_t, std::unordered_set<uint64_t>>& idx, uint64_t key ) const
+        {
+            std::vector<const entry*> result;
+            const auto itr = idx.find( key );
+            if ( itr == idx.end() ) return result;
+            result.reserve( itr->second.size() );
+            for ( const uint64_t slot : itr->second ) {
+                const entry& e = _entries[slot];
+                // token index is keyed by a hash, filter out colliding tokens
+                if ( &idx == &_by_token && token_key( e.contract, e.symcode ) != key ) continue;
+                result.push_back( &e );
+            }
+            return result;
+        }
+
+        void link( uint64_t slot )
+        {
+            const entry& e = _entries[slot];
+            // token symbols are only found by key
+            if ( e.table == table_tokens ) return;
+            _by_account[e.account].insert( slot );
+            _by_token[token_key( e.contract, e.symcode )].insert( slot );
+        }
+
+        void unlink( uint64_t slot )
+        {
+            const entry& e = _entries[slot];
+            if ( e.table == table_tokens ) return;
+            const auto drop = [&]( auto& idx, uint64_t key ) {
+                const auto itr = idx.find( key );
+                if ( itr == idx.end() ) return;
+                itr->second.erase( slot );
+                if ( itr->second.empty() ) idx.erase( itr );
+            };
+            drop( _by_account, e.account );
+            drop( _by_token, token_key( e.contract, e.symcode ) );
+        }
+
+        void rebuild_secondary()
+        {
+            _by_account.clear();
+            _by_token.clear();
+            for ( uint64_t slot = 0; slot < _header->capacity; slot++ ) {
+                if ( _entries[slot].state == slot_used ) link( slot );
+            }
+        }
+
+        void sync()
+        {
+            if ( msync( _header, _mapped, MS_SYNC ) ) throw std::runtime_error( "index: msync failed" );
+        }
+
+        void map_file( const std::string& path, uint64_t capacity )
+        {
+            if ( capacity & ( capacity - 1 ) ) throw std::runtime_error( "index: capacity must be a power of 2" );
+
+            _fd = ::open( path.c_str(), _read_only ? O_RDONLY : O_RDWR | O_CREAT, 0644 );
+            if ( _fd < 0 ) throw std::runtime_error( "index: cannot open " + path );
+
+            struct stat st;
+            fstat( _fd, &st );
+            const bool created = st.st_size == 0;
+            if ( created ) {
+                if ( _read_only ) throw std::runtime_error( "index: " + path + " is empty" );
+                if ( ftruncate( _fd, sizeof( header ) + capacity * sizeof( entry ) ) ) throw std::runtime_error( "index: cannot allocate " + path );
+                fstat( _fd, &st );
+            }
+
+            _mapped = st.st_size;
+            void* addr = mmap( nullptr, _mapped, _read_only ? PROT_READ : PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0 );
+            if ( addr == MAP_FAILED ) throw std::runtime_error( "index: mmap failed" );
+            _header = static_cast<header*>( addr );
+            _entries = reinterpret_cast<entry*>( static_cast<char*>( addr ) + sizeof( header ) );
+
+            if ( created ) {
+                _header->magic = header::magic_value;
+                _header->version = header::version_value;
+                _header->capacity = capacity;
+            }
+            if ( _header->magic != header::magic_value || _header->version != header::version_value ) throw std::runtime_error( "index: " + path + " is not a wallet.sx index" );
+            if ( _mapped != sizeof( header ) + _header->capacity * sizeof( entry ) ) throw std::runtime_error( "index: " + path + " is truncated" );
+        }
+
+        void unmap()
+        {
+            if ( _header ) munmap( _header, _mapped );
+            if ( _fd >= 0 ) ::close( _fd );
+            _header = nullptr;
+            _entries = nullptr;
+            _fd = -1;
+        }
+
+        // grow (or purge erased slots) into a new file once the table is 3/4 full, swapped in by rename
+        void reserve( uint64_t extra )
+        {
+            if ( ( _header->size + _header->erased + extra ) * 4 < _header->capacity * 3 ) return;
+
+            const uint64_t capacity = ( _header->size + extra ) * 2 < _header->capacity ? _header->capacity : _header->capacity * 2;
+            const std::string tmp = _path + ".tmp";
+            ::unlink( tmp.c_str() );
+            {
+                index next( tmp, capacity );
+                for ( uint64_t slot = 0; slot < _header->capacity; slot++ ) {
+                    if ( _entries[slot].state == slot_used ) next.upsert( _entries[slot] );
+                }
+                next.commit( _header->committed_block, _header->committed_id );
+            }
+            if ( std::rename( tmp.c_str(), _path.c_str() ) ) throw std::runtime_error( "index: cannot replace " + _path );
+
+            unmap();
+            map_file( _path, capacity );
+            rebuild_secondary();
+        }
+    };
+}
@@ -0,0 +1,183 @@
+/**
+ * wallet.sx state-history indexer
+ *
+ * Streams `contract_row` deltas of wallet.sx from the nodeos state-history websocket into a
+ * memory-mapped balance index, and answers balance queries from that index.
+ *
+ * usage:
+ *   wallet.sx.indexer sync    [--endpoint 127.0.0.1:8080] [--code wallet.sx] [--start <block>] [--commit-interval 120] [--exit-at-lib]
+ *   wallet.sx.indexer account <account>
+ *   wallet.sx.indexer token   <contract> <symcode>
+ *   wallet.sx.indexer balance <account> <contract> <symcode>
+ *
+ * every command accepts [--index wallet.sx.index] [--capacity 1048576]
+ */
+#include "wallet.hpp"
+
+#include <boost/asio/connect.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/websocket.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <tuple>
+
+namespace beast = boost::beast;
+namespace websocket = beast::websocket;
+namespace net = boost::asio;
+using tcp = net::ip::tcp;
+
+namespace {
+
+    struct options {
+        std::string                 command;
+        std::vector<std::string>    args;
+        std::string                 endpoint = "127.0.0.1:8080";
+        std::string                 code = "wallet.sx";
+        std::string                 index = "wallet.sx.index";
+        uint64_t                    capacity = 1 << 20;
+        uint32_t                    start = 0;
+        uint32_t                    commit_interval = 120;
+        bool                        exit_at_lib = false;
+    };
+
+    options parse( int argc, char** argv )
+    {
+        options opts;
+        for ( int i = 1; i < argc; i++ ) {
+            const std::string arg = argv[i];
+            const auto value = [&]() -> std::string {
+                if ( i + 1 >= argc ) throw std::runtime_error( "missing value for " + arg );
+                return argv[++i];
+            };
+            if ( arg == "--endpoint" ) opts.endpoint = value();
+            else if ( arg == "--code" ) opts.code = value();
+            else if ( arg == "--index" ) opts.index = value();
+            else if ( arg == "--capacity" ) opts.capacity = std::stoull( value() );
+            else if ( arg == "--start" ) opts.start = std::stoul( value() );
+            else if ( arg == "--commit-interval" ) opts.commit_interval = std::stoul( value() );
+            else if ( arg == "--exit-at-lib" ) opts.exit_at_lib = true;
+            else if ( opts.command.empty() ) opts.command = arg;
+            else opts.args.push_back( arg );
+        }
+        return opts;
+    }
+
+    void print( const std::vector<const indexer::entry*>& entries )
+    {
+        std::vector<const indexer::entry*> sorted = entries;
+        std::sort( sorted.begin(), sorted.end(), []( const auto* a, const auto* b ) {
+            return std::tie( a->account, a->contract, a->symcode ) < std::tie( b->account, b->contract, b->symcode );
+        });
+        for ( const indexer::entry* e : sorted ) {
+            printf( "%-13s %-13s %24s %10u%s\n",
+                    indexer::name_to_string( e->account ).c_str(),
+                    indexer::name_to_string( e->contract ).c_str(),
+                    indexer::format_asset( e->amount, e->precision, e->symcode ).c_str(),
+                    e->block_num,
+                    e->table == indexer::table_balances ? " (legacy)" : "" );
+        }
+    }
+
+    int sync( const options& opts )
+    {
+        indexer::index idx( opts.index, opts.capacity );
+        const uint64_t code = indexer::string_to_name( opts.code );
+        const uint32_t start = std::max( idx.committed_block() + 1, opts.start );
+
+        const size_t colon = opts.endpoint.rfind( ':' );
+        const std::string host = opts.endpoint.substr( 0, colon );
+        const std::string port = opts.endpoint.substr( colon + 1 );
+
+        net::io_context ioc;
+        tcp::resolver resolver{ ioc };
+        websocket::stream<tcp::socket> ws{ ioc };
+        net::connect( ws.next_layer(), resolver.resolve( host, port ) );
+        ws.handshake( host, "/" );
+        ws.read_message_max( 1ull << 32 );
+
+        // first message is the protocol ABI (json), messages are decoded as `v0` layouts
+        beast::flat_buffer buffer;
+        ws.read( buffer );
+        buffer.consume( buffer.size() );
+
+        // irreversible blocks only, applied deltas never need to be reverted
+        ws.binary( true );
+        const uint32_t in_flight = 1000;
+        ws.write( net::buffer( ship::get_blocks_request( start, in_flight, true ) ) );
+        fprintf( stderr, "syncing %s from block %u (index: %s, %lu entries)\n", opts.code.c_str(), start, opts.index.c_str(), idx.size() );
+
+        uint32_t last_commit = idx.committed_block();
+        for ( uint32_t received = 0;; ) {
+            ws.read( buffer );
+            const std::string_view message{ static_cast<const char*>( buffer.data().data() ), buffer.size() };
+            const auto result = ship::read_get_blocks_result( message );
+
+            if ( result && result->this_block ) {
+                const ship::block_position& block = *result->this_block;
+                // token cache first, `amounts` rows of the same block are decoded with it
+                if ( result->deltas ) {
+                    for ( const bool tokens : { true, false } ) {
+                        ship::for_each_contract_row( *result->deltas, [&]( const ship::contract_row& row ) {
+                            if ( row.code == code && indexer::is_tokens( row ) == tokens ) indexer::apply( idx, row, block.block_num );
+                        });
+                    }
+                }
+
+                const bool at_lib = block.block_num >= result->last_irreversible.block_num;
+                if ( at_lib || block.block_num - last_commit >= opts.commit_interval ) {
+                    idx.commit( block.block_num, block.block_id );
+                    last_commit = block.block_num;
+                }
+                if ( at_lib && opts.exit_at_lib ) {
+                    fprintf( stderr, "synced to block %u (%lu entries)\n", block.block_num, idx.size() );
+                    return 0;
+                }
+            }
+            buffer.consume( buffer.size() );
+
+            // acknowledge in batches to keep the stream flowing
+            if ( ++received == in_flight / 2 ) {
+                ws.write( net::buffer( ship::get_blocks_ack_request( received ) ) );
+                received = 0;
+            }
+        }
+    }
+
+    int query( const options& opts )
+    {
+        const indexer::index idx( opts.index, opts.capacity, true );
+        const auto arg = [&]( size_t i ) {
+            if ( i >= opts.args.size() ) throw std::runtime_error( "missing argument for " + opts.command );
+            return opts.args[i];
+        };
+
+        if ( opts.command == "account" ) {
+            print( idx.by_account( indexer::string_to_name( arg( 0 ) ) ) );
+        } else if ( opts.command == "token" ) {
+            print( idx.by_token( indexer::string_to_name( arg( 0 ) ), indexer::string_to_symbol_code( arg( 1 ) ) ) );
+        } else if ( opts.command == "balance" ) {
+            const indexer::entry* e = idx.find( indexer::string_to_name( arg( 0 ) ), indexer::string_to_name( arg( 1 ) ), indexer::string_to_symbol_code( arg( 2 ) ) );
+            if ( !e ) return 1;
+            print( { e } );
+        } else {
+            throw std::runtime_error( "unknown command: " + opts.command );
+        }
+        return 0;
+    }
+}
+
+int main( int argc, char** argv )
+{
+    try {
+        const options opts = parse( argc, argv );
+        if ( opts.command == "sync" ) return sync( opts );
+        return query( opts );
+    } catch ( const std::exception& e ) {
+        fprintf( stderr, "error: %s\n", e.what() );
+        return 2;
+    }
+}
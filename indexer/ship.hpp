@@ -0,0 +1,209 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+/**
+ * Minimal decoder for the state-history (SHiP) websocket protocol, `v0` messages only.
+ *
+ * Only the fields needed to follow `contract_row` deltas are decoded; everything else is skipped
+ * in place, no copies are made of block, trace or delta payloads.
+ */
+namespace ship {
+
+    struct reader {
+        const char* pos;
+        const char* end;
+
+        reader( const char* data, size_t size ) : pos( data ), end( data + size ) {}
+        explicit reader( std::string_view data ) : reader( data.data(), data.size() ) {}
+
+        size_t remaining() const { return end - pos; }
+
+        void need( size_t size ) const
+        {
+            if ( remaining() < size ) throw std::runtime_error( "ship: unexpected end of message" );
+        }
+
+        template <typename T>
+        T read()
+        {
+            need( sizeof( T ) );
+            T value;
+            memcpy( &value, pos, sizeof( T ) );
+            pos += sizeof( T );
+            return value;
+        }
+
+        uint32_t read_varuint32()
+        {
+            uint32_t value = 0;
+            for ( int shift = 0; shift < 35; shift += 7 ) {
+                const uint8_t b = read<uint8_t>();
+                value |= uint32_t( b & 0x7f ) << shift;
+                if ( !( b & 0x80 ) ) return value;
+            }
+            throw std::runtime_error( "ship: invalid varuint32" );
+        }
+
+        uint64_t read_varuint64()
+        {
+            uint64_t value = 0;
+            for ( int shift = 0; shift < 64; shift += 7 ) {
+                const uint8_t b = read<uint8_t>();
+                value |= uint64_t( b & 0x7f ) << shift;
+                if ( !( b & 0x80 ) ) return value;
+            }
+            throw std::runtime_error( "ship: invalid varuint64" );
+        }
+
+        std::string_view read_bytes()
+        {
+            const uint32_t size = read_varuint32();
+            need( size );
+            const std::string_view bytes{ pos, size };
+            pos += size;
+            return bytes;
+        }
+
+        bool read_bool() { return read<uint8_t>() != 0; }
+    };
+
+    struct block_position {
+        uint32_t                    block_num = 0;
+        std::array<char, 32>        block_id = {};
+    };
+
+    inline block_position read_block_position( reader& r )
+    {
+        block_position pos;
+        pos.block_num = r.read<uint32_t>();
+        r.need( 32 );
+        memcpy( pos.block_id.data(), r.pos, 32 );
+        r.pos += 32;
+        return pos;
+    }
+
+    struct get_blocks_result {
+        block_position                      head;
+        block_position                      last_irreversible;
+        std::optional<block_position>       this_block;
+        std::optional<block_position>       prev_block;
+        std::optional<std::string_view>     deltas;
+    };
+
+    // `result` variant: 0 = get_status_result_v0, 1 = get_blocks_result_v0
+    inline std::optional<get_blocks_result> read_get_blocks_result( std::string_view message )
+    {
+        reader r{ message };
+        if ( r.read_varuint32() != 1 ) return {};
+
+        get_blocks_result result;
+        result.head = read_block_position( r );
+        result.last_irreversible = read_block_position( r );
+        if ( r.read_bool() ) result.this_block = read_block_position( r );
+        if ( r.read_bool() ) result.prev_block = read_block_position( r );
+        if ( r.read_bool() ) r.read_bytes();                        // block
+        if ( r.read_bool() ) r.read_bytes();                        // traces
+        if ( r.read_bool() ) result.deltas = r.read_bytes();
+        return result;
+    }
+
+    struct writer {
+        std::vector<char> data;
+
+        template <typename T>
+        void write( const T& value )
+        {
+            const char* p = reinterpret_cast<const char*>( &value );
+            data.insert( data.end(), p, p + sizeof( T ) );
+        }
+
+        void write_varuint32( uint32_t value )
+        {
+            do {
+                uint8_t b = value & 0x7f;
+                value >>= 7;
+                if ( value ) b |= 0x80;
+                data.push_back( char( b ) );
+            } while ( value );
+        }
+    };
+
+    // `request` variant 1 = get_blocks_request_v0 (deltas only, no positions)
+    inline std::vector<char> get_blocks_request( uint32_t start_block, uint32_t max_messages_in_flight, bool irreversible_only )
+    {
+        writer w;
+        w.write_varuint32( 1 );
+        w.write<uint32_t>( start_block );
+        w.write<uint32_t>( 0xffffffff );                           // end_block_num
+        w.write<uint32_t>( max_messages_in_flight );
+        w.write_varuint32( 0 );                                     // have_positions
+        w.write<uint8_t>( irreversible_only );
+        w.write<uint8_t>( false );                                  // fetch_block
+        w.write<uint8_t>( false );                                  // fetch_traces
+        w.write<uint8_t>( true );                                   // fetch_deltas
+        return w.data;
+    }
+
+    // `request` variant 2 = get_blocks_ack_request_v0
+    inline std::vector<char> get_blocks_ack_request( uint32_t num_messages )
+    {
+        writer w;
+        w.write_varuint32( 2 );
+        w.write<uint32_t>( num_messages );
+        return w.data;
+    }
+
+    struct contract_row {
+        bool                    present;
+        uint64_t                code;
+        uint64_t                scope;
+        uint64_t                table;
+        uint64_t                primary_key;
+        uint64_t                payer;
+        std::string_view        value;
+    };
+
+    /**
+     * Iterate `contract_row` deltas of a `get_blocks_result_v0.deltas` payload (packed `vector<table_delta>`).
+     */
+    template <typename F>
+    void for_each_contract_row( std::string_view deltas, F&& f )
+    {
+        reader r{ deltas };
+        for ( uint32_t n = r.read_varuint32(); n > 0; n-- ) {
+            // table_delta_v0 & table_delta_v1 share the same layout
+            const uint32_t version = r.read_varuint32();
+            if ( version > 1 ) throw std::runtime_error( "ship: unsupported table_delta version" );
+
+            const uint32_t name_size = r.read_varuint32();
+            r.need( name_size );
+            const std::string_view table_name{ r.pos, name_size };
+            r.pos += name_size;
+
+            for ( uint32_t rows = r.read_varuint32(); rows > 0; rows-- ) {
+                const bool present = r.read_bool();
+                const std::string_view data = r.read_bytes();
+                if ( table_name != "contract_row" ) continue;
+
+                reader row{ data };
+                if ( row.read_varuint32() != 0 ) throw std::runtime_error( "ship: unsupported contract_row version" );
+                contract_row delta;
+                delta.present = present;
+                delta.code = row.read<uint64_t>();
+                delta.scope = row.read<uint64_t>();
+                delta.table = row.read<uint64_t>();
+                delta.primary_key = row.read<uint64_t>();
+                delta.payer = row.read<uint64_t>();
+                delta.value = row.read_bytes();
+                f( delta );
+            }
+        }
+    }
+}
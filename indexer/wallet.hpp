@@ -0,0 +1,158 @@
+#pragma once
+
+#include "index.hpp"
+#include "ship.hpp"
+
+#include <string>
+#include <string_view>
+
+/**
+ * wallet.sx row decoding & apply logic (binary layouts of `amounts_row`, `tokens_row` & legacy `balances_row`).
+ */
+namespace indexer {
+
+    inline uint64_t string_to_name( std::string_view str )
+    {
+        uint64_t value = 0;
+        for ( size_t i = 0; i < str.size() && i < 13; i++ ) {
+            const char c = str[i];
+            uint64_t digit = 0;
+            if ( c >= 'a' && c <= 'z' ) digit = c - 'a' + 6;
+            else if ( c >= '1' && c <= '5' ) digit = c - '1' + 1;
+            else if ( c != '.' ) throw std::runtime_error( "invalid name: " + std::string( str ) );
+            value |= i < 12 ? ( digit & 0x1f ) << ( 64 - 5 * ( i + 1 ) ) : digit & 0x0f;
+        }
+        return value;
+    }
+
+    inline std::string name_to_string( uint64_t value )
+    {
+        static const char* charmap = ".12345abcdefghijklmnopqrstuvwxyz";
+        std::string str( 13, '.' );
+        uint64_t tmp = value;
+        for ( int i = 0; i <= 12; i++ ) {
+            const char c = charmap[tmp & ( i == 0 ? 0x0f : 0x1f )];
+            str[12 - i] = c;
+            tmp >>= ( i == 0 ? 4 : 5 );
+        }
+        str.erase( str.find_last_not_of( '.' ) + 1 );
+        return str;
+    }
+
+    inline uint64_t string_to_symbol_code( std::string_view str )
+    {
+        if ( str.empty() || str.size() > 7 ) throw std::runtime_error( "invalid symbol code: " + std::string( str ) );
+        uint64_t value = 0;
+        for ( size_t i = 0; i < str.size(); i++ ) {
+            if ( str[i] < 'A' || str[i] > 'Z' ) throw std::runtime_error( "invalid symbol code: " + std::string( str ) );
+            value |= uint64_t( str[i] ) << ( 8 * i );
+        }
+        return value;
+    }
+
+    inline std::string symbol_code_to_string( uint64_t value )
+    {
+        std::string str;
+        for ( ; value; value >>= 8 ) str += char( value & 0xff );
+        return str;
+    }
+
+    // "1.0000 EOS"
+    inline std::string format_asset( int64_t amount, uint8_t precision, uint64_t symcode )
+    {
+        const bool negative = amount < 0;
+        const uint64_t abs = negative ? -uint64_t( amount ) : uint64_t( amount );
+        std::string digits = std::to_string( abs );
+        if ( precision ) {
+            if ( digits.size() <= precision ) digits.insert( 0, precision + 1 - digits.size(), '0' );
+            digits.insert( digits.size() - precision, "." );
+        }
+        return ( negative ? "-" : "" ) + digits + " " + symbol_code_to_string( symcode );
+    }
+
+    inline bool is_tokens( const ship::contract_row& row )
+    {
+        static const uint64_t tokens_table = string_to_name( "tokens" );
+        return row.table == tokens_table;
+    }
+
+    /**
+     * Apply one wallet.sx `contract_row` delta to the index.
+     *
+     * `amounts` rows are decoded with the `tokens` cache, apply the `tokens` deltas of a block first.
+     */
+    inline void apply( index& idx, const ship::contract_row& row, uint32_t block_num )
+    {
+        static const uint64_t amounts_table = string_to_name( "amounts" );
+        static const uint64_t balances_table = string_to_name( "balances" );
+
+        const uint64_t account = row.scope;
+
+        // {uint64_t id; extended_symbol sym}, evicted tokens are kept to decode existing `amounts` entries
+        if ( is_tokens( row ) ) {
+            if ( !row.present ) return;
+            ship::reader r{ row.value };
+            entry e = {};
+            e.primary_key = r.read<uint64_t>();
+            const uint64_t sym = r.read<uint64_t>();
+            e.precision = sym & 0xff;
+            e.symcode = sym >> 8;
+            e.contract = r.read<uint64_t>();
+            e.table = table_tokens;
+            e.block_num = block_num;
+            idx.upsert( e );
+            return;
+        }
+
+        // {name contract; bytes entries}, entries are (varuint symcode, varuint amount << 1 | opened), primary key = contract
+        if ( row.table == amounts_table ) {
+            const uint64_t contract = row.primary_key;
+            idx.erase_if( account, [&]( const entry& e ) { return e.table == table_amounts && e.contract == contract; } );
+            if ( !row.present ) return;
+
+            ship::reader r{ row.value };
+            r.read<uint64_t>();
+            ship::reader entries{ r.read_bytes() };
+            while ( entries.remaining() ) {
+                entry e = {};
+                e.account = account;
+                e.contract = contract;
+                e.primary_key = contract;
+                e.symcode = entries.read_varuint64();
+                e.amount = entries.read_varuint64() >> 1;
+
+                const entry* token = idx.token( contract, e.symcode );
+                if ( !token ) throw std::runtime_error( "unknown token of `amounts` entry, sync from an earlier block" );
+                e.precision = token->precision;
+                e.table = table_amounts;
+                e.block_num = block_num;
+                idx.upsert( e );
+            }
+            return;
+        }
+
+        // {name contract; map<symbol_code, asset> balances}, primary key = contract
+        if ( row.table == balances_table ) {
+            const uint64_t contract = row.primary_key;
+            idx.erase_if( account, [&]( const entry& e ) { return e.table == table_balances && e.contract == contract; } );
+            if ( !row.present ) return;
+
+            ship::reader r{ row.value };
+            r.read<uint64_t>();
+            for ( uint32_t n = r.read_varuint32(); n > 0; n-- ) {
+                entry e = {};
+                e.account = account;
+                e.contract = contract;
+                e.primary_key = contract;
+                r.read<uint64_t>();                                 // map key (symbol_code)
+                e.amount = r.read<int64_t>();
+                const uint64_t sym = r.read<uint64_t>();
+                e.precision = sym & 0xff;
+                e.symcode = sym >> 8;
+                e.table = table_balances;
+                e.block_num = block_num;
+                idx.upsert( e );
+            }
+        }
+    }
+}
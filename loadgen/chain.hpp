@@ -0,0 +1,297 @@
+#pragma once
+
+#include "crypto.hpp"
+
+#include <boost/asio/connect.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <ctime>
+#include <optional>
+#include <sstream>
+
+/**
+ * Transaction packing & signing, and a keep-alive HTTP client for the nodeos chain API.
+ */
+namespace loadgen {
+
+    namespace beast = boost::beast;
+    namespace http = beast::http;
+    namespace net = boost::asio;
+    using tcp = net::ip::tcp;
+    using json = boost::property_tree::ptree;
+
+    inline uint64_t string_to_name( std::string_view str )
+    {
+        uint64_t value = 0;
+        for ( size_t i = 0; i < str.size() && i < 13; i++ ) {
+            const char c = str[i];
+            uint64_t digit = 0;
+            if ( c >= 'a' && c <= 'z' ) digit = c - 'a' + 6;
+            else if ( c >= '1' && c <= '5' ) digit = c - '1' + 1;
+            else if ( c != '.' ) throw std::runtime_error( "invalid name: " + std::string( str ) );
+            value |= i < 12 ? ( digit & 0x1f ) << ( 64 - 5 * ( i + 1 ) ) : digit & 0x0f;
+        }
+        return value;
+    }
+
+    // symbol {precision, code}, as serialized in `asset`
+    inline uint64_t string_to_symbol( uint8_t precision, std::string_view code )
+    {
+        if ( code.empty() || code.size() > 7 ) throw std::runtime_error( "invalid symbol code: " + std::string( code ) );
+        uint64_t value = precision;
+        for ( size_t i = 0; i < code.size(); i++ ) {
+            if ( code[i] < 'A' || code[i] > 'Z' ) throw std::runtime_error( "invalid symbol code: " + std::string( code ) );
+            value |= uint64_t( code[i] ) << ( 8 * ( i + 1 ) );
+        }
+        return value;
+    }
+
+    inline std::string to_hex( std::string_view data )
+    {
+        static const char* digits = "0123456789abcdef";
+        std::string hex;
+        hex.reserve( data.size() * 2 );
+        for ( const unsigned char c : data ) {
+            hex += digits[c >> 4];
+            hex += digits[c & 0xf];
+        }
+        return hex;
+    }
+
+    inline bytes from_hex( std::string_view hex )
+    {
+        const auto nibble = []( char c ) -> unsigned char {
+            if ( c >= '0' && c <= '9' ) return c - '0';
+            if ( c >= 'a' && c <= 'f' ) return c - 'a' + 10;
+            if ( c >= 'A' && c <= 'F' ) return c - 'A' + 10;
+            throw std::runtime_error( "invalid hex string" );
+        };
+        if ( hex.size() % 2 ) throw std::runtime_error( "invalid hex string" );
+        bytes data( hex.size() / 2 );
+        for ( size_t i = 0; i < data.size(); i++ ) data[i] = nibble( hex[2 * i] ) << 4 | nibble( hex[2 * i + 1] );
+        return data;
+    }
+
+    // "2026-10-16T12:00:00.500" => seconds since epoch (UTC)
+    inline uint32_t parse_time_point( const std::string& str )
+    {
+        std::tm tm = {};
+        if ( !strptime( str.c_str(), "%Y-%m-%dT%H:%M:%S", &tm ) ) throw std::runtime_error( "invalid time point: " + str );
+        return timegm( &tm );
+    }
+
+    // little-endian binary serialization of the EOSIO ABI types used below
+    struct packer {
+        std::string data;
+
+        template <typename T>
+        packer& pack( T value )
+        {
+            data.append( reinterpret_cast<const char*>( &value ), sizeof( T ) );
+            return *this;
+        }
+
+        packer& varuint32( uint32_t value )
+        {
+            do {
+                uint8_t byte = value & 0x7f;
+                value >>= 7;
+                if ( value ) byte |= 0x80;
+                data += char( byte );
+            } while ( value );
+            return *this;
+        }
+
+        packer& raw( const void* bytes, size_t size )
+        {
+            data.append( static_cast<const char*>( bytes ), size );
+            return *this;
+        }
+
+        packer& str( std::string_view value )
+        {
+            varuint32( value.size() );
+            return raw( value.data(), value.size() );
+        }
+
+        packer& asset( int64_t amount, uint64_t symbol ) { return pack( amount ).pack( symbol ); }
+    };
+
+    struct permission_level {
+        uint64_t actor;
+        uint64_t permission;
+    };
+
+    struct action {
+        uint64_t                        account;
+        uint64_t                        name;
+        std::vector<permission_level>   authorization;
+        std::string                     data;
+    };
+
+    // TaPoS reference of a recent block, refreshed from `get_info`
+    struct chain_state {
+        checksum256     chain_id;
+        uint32_t        head_block_num;
+        uint32_t        head_block_time;
+        uint32_t        last_irreversible_block_num;
+        uint16_t        ref_block_num;
+        uint32_t        ref_block_prefix;
+    };
+
+    inline chain_state read_chain_state( const json& info )
+    {
+        chain_state state;
+        const bytes chain_id = from_hex( info.get<std::string>( "chain_id" ) );
+        if ( chain_id.size() != state.chain_id.size() ) throw std::runtime_error( "invalid chain_id" );
+        std::copy( chain_id.begin(), chain_id.end(), state.chain_id.begin() );
+
+        state.head_block_num = info.get<uint32_t>( "head_block_num" );
+        state.head_block_time = parse_time_point( info.get<std::string>( "head_block_time" ) );
+        state.last_irreversible_block_num = info.get<uint32_t>( "last_irreversible_block_num" );
+
+        // ref_block_prefix = 2nd 64-bit word of the block id (its first 32 bits, little-endian)
+        const bytes block_id = from_hex( info.get<std::string>( "head_block_id" ) );
+        state.ref_block_num = state.head_block_num & 0xffff;
+        memcpy( &state.ref_block_prefix, block_id.data() + 8, sizeof( uint32_t ) );
+        return state;
+    }
+
+    inline std::string pack_transaction( uint32_t expiration, const chain_state& state, const std::vector<action>& actions )
+    {
+        packer p;
+        p.pack( expiration ).pack( state.ref_block_num ).pack( state.ref_block_prefix );
+        p.varuint32( 0 );                                   // max_net_usage_words
+        p.pack<uint8_t>( 0 );                               // max_cpu_usage_ms
+        p.varuint32( 0 );                                   // delay_sec
+        p.varuint32( 0 );                                   // context_free_actions
+        p.varuint32( actions.size() );
+        for ( const action& act : actions ) {
+            p.pack( act.account ).pack( act.name );
+            p.varuint32( act.authorization.size() );
+            for ( const permission_level& level : act.authorization ) p.pack( level.actor ).pack( level.permission );
+            p.str( act.data );
+        }
+        p.varuint32( 0 );                                   // transaction_extensions
+        return p.data;
+    }
+
+    /**
+     * `push_transaction` request body: sign digest = sha256(chain_id | packed_trx | 32 zero bytes),
+     * the trailing zeros standing for the hash of empty context free data.
+     */
+    inline std::string signed_transaction( private_key& key, const chain_state& state, const std::string& packed_trx )
+    {
+        std::string message( state.chain_id.begin(), state.chain_id.end() );
+        message += packed_trx;
+        message.append( 32, '\0' );
+        const std::string signature = key.sign( sha256( message.data(), message.size() ) );
+        return R"({"signatures":[")" + signature + R"("],"compression":"none","packed_context_free_data":"","packed_trx":")" + to_hex( packed_trx ) + R"("})";
+    }
+
+    inline json parse_json( const std::string& body )
+    {
+        json tree;
+        std::istringstream stream( body );
+        boost::property_tree::read_json( stream, tree );
+        return tree;
+    }
+
+    /**
+     * Assertion message of a failed chain API call ("no balance found", "duplicate transaction", ...)
+     */
+    inline std::string failure_reason( const std::string& body )
+    {
+        try {
+            const json tree = parse_json( body );
+            std::string reason = tree.get<std::string>( "error.what", tree.get<std::string>( "message", "unknown error" ) );
+            if ( const auto details = tree.get_child_optional( "error.details" ); details && !details->empty() ) {
+                reason = details->front().second.get<std::string>( "message", reason );
+            }
+            const std::string_view prefix = "assertion failure with message: ";
+            if ( reason.compare( 0, prefix.size(), prefix ) == 0 ) reason.erase( 0, prefix.size() );
+            return reason;
+        } catch ( const std::exception& ) {
+            return "invalid response: " + body.substr( 0, 80 );
+        }
+    }
+
+    struct response {
+        unsigned int    status;
+        std::string     body;
+
+        bool ok() const { return status >= 200 && status < 300; }
+    };
+
+    /**
+     * Keep-alive HTTP/1.1 connection to nodeos, reconnects once when the server dropped it.
+     */
+    class client {
+    public:
+        explicit client( const std::string& endpoint )
+        {
+            const size_t colon = endpoint.rfind( ':' );
+            if ( colon == std::string::npos ) throw std::runtime_error( "invalid endpoint (host:port): " + endpoint );
+            _host = endpoint.substr( 0, colon );
+            _port = endpoint.substr( colon + 1 );
+        }
+
+        response post( const std::string& target, const std::string& body )
+        {
+            for ( int attempt = 0;; attempt++ ) {
+                try {
+                    if ( !_stream ) connect();
+                    http::request<http::string_body> req{ http::verb::post, target, 11 };
+                    req.set( http::field::host, _host );
+                    req.set( http::field::content_type, "application/json" );
+                    req.keep_alive( true );
+                    req.body() = body;
+                    req.prepare_payload();
+                    http::write( *_stream, req );
+
+                    http::response<http::string_body> res;
+                    http::read( *_stream, _buffer, res );
+                    if ( !res.keep_alive() ) _stream.reset();
+                    return { res.result_int(), std::move( res.body() ) };
+                } catch ( const boost::system::system_error& ) {
+                    _stream.reset();
+                    if ( attempt > 0 ) throw;
+                }
+            }
+        }
+
+        json get_info() { return call( "/v1/chain/get_info", "{}" ); }
+
+        json get_block( uint32_t block_num )
+        {
+            return call( "/v1/chain/get_block", R"({"block_num_or_id":")" + std::to_string( block_num ) + R"("})" );
+        }
+
+    private:
+        net::io_context                         _ioc;
+        std::optional<beast::tcp_stream>        _stream;
+        beast::flat_buffer                      _buffer;
+        std::string                             _host;
+        std::string                             _port;
+
+        void connect()
+        {
+            tcp::resolver resolver{ _ioc };
+            _stream.emplace( _ioc );
+            _stream->connect( resolver.resolve( _host, _port ) );
+            _stream->socket().set_option( tcp::no_delay( true ) );
+            _buffer.clear();
+        }
+
+        json call( const std::string& target, const std::string& body )
+        {
+            const response res = post( target, body );
+            if ( !res.ok() ) throw std::runtime_error( target + ": " + failure_reason( res.body ) );
+            return parse_json( res.body );
+        }
+    };
+}
@@ -0,0 +1,217 @@
+#pragma once
+
+// low-level EC_KEY / ECDSA interface, still shipped by OpenSSL 3
+#define OPENSSL_SUPPRESS_DEPRECATED
+
+#include <openssl/bn.h>
+#include <openssl/ec.h>
+#include <openssl/obj_mac.h>
+#include <openssl/ripemd.h>
+#include <openssl/sha.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * EOSIO key & signature encoding (legacy `EOS` public keys, WIF private keys, `SIG_K1_` signatures)
+ * and canonical secp256k1 signing with OpenSSL.
+ */
+namespace loadgen {
+
+    using bytes = std::vector<unsigned char>;
+    using checksum256 = std::array<unsigned char, 32>;
+
+    inline checksum256 sha256( const void* data, size_t size )
+    {
+        checksum256 digest;
+        SHA256( static_cast<const unsigned char*>( data ), size, digest.data() );
+        return digest;
+    }
+
+    inline std::array<unsigned char, 20> ripemd160( const void* data, size_t size )
+    {
+        std::array<unsigned char, 20> digest;
+        RIPEMD160( static_cast<const unsigned char*>( data ), size, digest.data() );
+        return digest;
+    }
+
+    inline const char* base58_chars = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+
+    inline std::string base58_encode( const bytes& data )
+    {
+        // base 256 => base 58, digits little-endian
+        std::vector<unsigned char> digits;
+        for ( const unsigned char byte : data ) {
+            uint32_t carry = byte;
+            for ( auto& digit : digits ) {
+                carry += uint32_t( digit ) << 8;
+                digit = carry % 58;
+                carry /= 58;
+            }
+            for ( ; carry; carry /= 58 ) digits.push_back( carry % 58 );
+        }
+        std::string str;
+        for ( size_t i = 0; i < data.size() && data[i] == 0; i++ ) str += '1';
+        for ( auto itr = digits.rbegin(); itr != digits.rend(); ++itr ) str += base58_chars[*itr];
+        return str;
+    }
+
+    inline bytes base58_decode( std::string_view str )
+    {
+        // base 58 => base 256, bytes little-endian
+        bytes data;
+        for ( const char c : str ) {
+            const char* pos = c ? strchr( base58_chars, c ) : nullptr;
+            if ( !pos ) throw std::runtime_error( "invalid base58 string" );
+            uint32_t carry = pos - base58_chars;
+            for ( auto& byte : data ) {
+                carry += uint32_t( byte ) * 58;
+                byte = carry & 0xff;
+                carry >>= 8;
+            }
+            for ( ; carry; carry >>= 8 ) data.push_back( carry & 0xff );
+        }
+        for ( size_t i = 0; i < str.size() && str[i] == '1'; i++ ) data.push_back( 0 );
+        std::reverse( data.begin(), data.end() );
+        return data;
+    }
+
+    // ripemd160 checksum of K1 keys & signatures, `suffix` is the key type ("" for legacy keys)
+    inline bytes with_checksum( bytes data, std::string_view suffix )
+    {
+        bytes hashed = data;
+        hashed.insert( hashed.end(), suffix.begin(), suffix.end() );
+        const auto digest = ripemd160( hashed.data(), hashed.size() );
+        data.insert( data.end(), digest.begin(), digest.begin() + 4 );
+        return data;
+    }
+
+    /**
+     * secp256k1 private key decoded from WIF.
+     *
+     * Not thread-safe: each signing thread constructs its own key.
+     */
+    class private_key {
+    public:
+        explicit private_key( std::string_view wif )
+        {
+            // 0x80 | key (32) | sha256(sha256(0x80 | key))[0..4]
+            const bytes raw = base58_decode( wif );
+            if ( raw.size() != 37 || raw[0] != 0x80 ) throw std::runtime_error( "invalid WIF private key" );
+            const checksum256 first = sha256( raw.data(), 33 );
+            const checksum256 second = sha256( first.data(), first.size() );
+            if ( memcmp( second.data(), raw.data() + 33, 4 ) ) throw std::runtime_error( "invalid WIF private key checksum" );
+
+            _ctx = BN_CTX_new();
+            _key = EC_KEY_new_by_curve_name( NID_secp256k1 );
+            const EC_GROUP* group = EC_KEY_get0_group( _key );
+            _order = BN_new();
+            _half_order = BN_new();
+            EC_GROUP_get_order( group, _order, _ctx );
+            BN_rshift1( _half_order, _order );
+
+            BIGNUM* secret = BN_bin2bn( raw.data() + 1, 32, nullptr );
+            EC_POINT* pub = EC_POINT_new( group );
+            EC_POINT_mul( group, pub, secret, nullptr, nullptr, _ctx );
+            EC_KEY_set_private_key( _key, secret );
+            EC_KEY_set_public_key( _key, pub );
+            EC_POINT_point2oct( group, pub, POINT_CONVERSION_COMPRESSED, _public.data(), _public.size(), _ctx );
+            EC_POINT_free( pub );
+            BN_clear_free( secret );
+        }
+
+        ~private_key()
+        {
+            EC_KEY_free( _key );
+            BN_free( _order );
+            BN_free( _half_order );
+            BN_CTX_free( _ctx );
+        }
+
+        private_key( const private_key& ) = delete;
+        private_key& operator=( const private_key& ) = delete;
+
+        // compressed public key, as serialized in `authority` (after the K1 variant index)
+        const std::array<unsigned char, 33>& public_key() const { return _public; }
+
+        // "EOS6MRy..."
+        std::string public_key_string() const
+        {
+            return "EOS" + base58_encode( with_checksum( bytes( _public.begin(), _public.end() ), "" ) );
+        }
+
+        /**
+         * Sign `digest`, returns "SIG_K1_..."
+         *
+         * ECDSA is computed here rather than with `ECDSA_do_sign`: the recovery id comes for free from
+         * the nonce point R. nodeos only accepts canonical signatures (low S, no leading zero & no high
+         * bit in r & s), nonces are random so signing is retried until one is.
+         */
+        std::string sign( const checksum256& digest )
+        {
+            const EC_GROUP* group = EC_KEY_get0_group( _key );
+            const BIGNUM* secret = EC_KEY_get0_private_key( _key );
+            EC_POINT* R = EC_POINT_new( group );
+            BN_CTX_start( _ctx );
+            BIGNUM* k = BN_CTX_get( _ctx );
+            BIGNUM* x = BN_CTX_get( _ctx );
+            BIGNUM* y = BN_CTX_get( _ctx );
+            BIGNUM* r = BN_CTX_get( _ctx );
+            BIGNUM* s = BN_CTX_get( _ctx );
+            BIGNUM* e = BN_CTX_get( _ctx );
+            BN_bin2bn( digest.data(), digest.size(), e );
+
+            // recovery id | r | s
+            bytes compact( 65 );
+            for ( ;; ) {
+                // R = k G, r = R.x mod n, s = k^-1 (e + r d) mod n
+                BN_priv_rand_range( k, _order );
+                if ( BN_is_zero( k ) ) continue;
+                EC_POINT_mul( group, R, k, nullptr, nullptr, _ctx );
+                EC_POINT_get_affine_coordinates( group, R, x, y, _ctx );
+                BN_nnmod( r, x, _order, _ctx );
+                if ( BN_is_zero( r ) ) continue;
+                BN_mod_mul( s, r, secret, _order, _ctx );
+                BN_mod_add( s, s, e, _order, _ctx );
+                BN_mod_inverse( k, k, _order, _ctx );
+                BN_mod_mul( s, s, k, _order, _ctx );
+                if ( BN_is_zero( s ) ) continue;
+
+                // recovery id: parity of R.y, R.x overflowed n; negating s flips the parity
+                int recovery = ( BN_is_odd( y ) ? 1 : 0 ) | ( BN_cmp( x, _order ) >= 0 ? 2 : 0 );
+                if ( BN_cmp( s, _half_order ) > 0 ) {
+                    BN_sub( s, _order, s );
+                    recovery ^= 1;
+                }
+                BN_bn2binpad( r, compact.data() + 1, 32 );
+                BN_bn2binpad( s, compact.data() + 33, 32 );
+                if ( !is_canonical( compact ) ) continue;
+
+                compact[0] = 27 + 4 + recovery;
+                break;
+            }
+            BN_CTX_end( _ctx );
+            EC_POINT_free( R );
+            return "SIG_K1_" + base58_encode( with_checksum( compact, "K1" ) );
+        }
+
+    private:
+        EC_KEY*                         _key;
+        BN_CTX*                         _ctx;
+        BIGNUM*                         _order;
+        BIGNUM*                         _half_order;
+        std::array<unsigned char, 33>   _public;
+
+        static bool is_canonical( const bytes& c )
+        {
+            return !( c[1] & 0x80 ) && !( c[1] == 0 && !( c[2] & 0x80 ) )
+                && !( c[33] & 0x80 ) && !( c[33] == 0 && !( c[34] & 0x80 ) );
+        }
+    };
+}
@@ -0,0 +1,479 @@
+/**
+ * wallet.sx transaction load generator
+ *
+ * Creates & funds load accounts with the development key of `scripts/deploy.sh`, then signs and pushes
+ * deposit / withdraw / open / close transactions from worker threads into nodeos over HTTP, and reports
+ * achieved TPS, failure reasons and actions per block.
+ *
+ * usage:
+ *   wallet.sx.loadgen setup [--accounts 1000] [--fund 100.0000] [--deposit 10.0000] [--batch 50]
+ *   wallet.sx.loadgen run   [--accounts 1000] [--threads 8] [--rate 0] [--duration 60]
+ *                           [--mix deposit=40,withdraw=40,open=10,close=10] [--hot-accounts 0.01] [--hot-share 0]
+ *                           [--seed 1] [--no-blocks]
+ *
+ * every command accepts [--endpoint 127.0.0.1:8888] [--key <WIF>] [--prefix lg] [--code wallet.sx] [--token eosio.token]
+ */
+#include "chain.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <random>
+#include <thread>
+
+using namespace loadgen;
+
+namespace {
+
+    // eosio development key, owner of every account created by scripts/deploy.sh (EOS6MRy...)
+    const char* dev_key = "5KQwrPbwdL6PhXujxW37FSSQZ1JiwsST4cqQzDeyXtP79zkvFD3";
+
+    const char* push_target = "/v1/chain/push_transaction";
+
+    enum op : uint8_t {
+        op_deposit,
+        op_withdraw,
+        op_open,
+        op_close,
+        op_count
+    };
+
+    const char* op_names[op_count] = { "deposit", "withdraw", "open", "close" };
+
+    struct options {
+        std::string                 command;
+        std::string                 endpoint = "127.0.0.1:8888";
+        std::string                 key = dev_key;
+        std::string                 prefix = "lg";
+        std::string                 code = "wallet.sx";
+        std::string                 token = "eosio.token";
+        std::string                 symcode = "EOS";                    // deposited & withdrawn, precision 4
+        std::string                 open_symcode = "LOAD";              // opened & closed, never deposited
+        uint32_t                    accounts = 1000;
+        int64_t                     fund = 1000000;                     // 100.0000 EOS per account
+        int64_t                     deposit = 100000;                   // 10.0000 EOS per account
+        uint32_t                    batch = 50;
+        uint32_t                    threads = 8;
+        double                      rate = 0;                           // transactions per second, 0 = unlimited
+        double                      duration = 60;
+        std::array<double, op_count> mix = { 40, 40, 10, 10 };
+        double                      hot_accounts = 0.01;
+        double                      hot_share = 0;
+        uint64_t                    seed = 1;
+        bool                        blocks = true;
+    };
+
+    // "100.0000" => 1000000
+    int64_t parse_amount( const std::string& str )
+    {
+        return std::llround( std::stod( str ) * 10000 );
+    }
+
+    std::array<double, op_count> parse_mix( const std::string& str )
+    {
+        std::array<double, op_count> mix = {};
+        std::istringstream stream( str );
+        for ( std::string item; std::getline( stream, item, ',' ); ) {
+            const size_t equal = item.find( '=' );
+            const std::string key = item.substr( 0, equal );
+            const auto itr = std::find_if( std::begin( op_names ), std::end( op_names ), [&]( const char* name ) { return key == name; } );
+            if ( equal == std::string::npos || itr == std::end( op_names ) ) throw std::runtime_error( "invalid mix entry: " + item );
+            mix[itr - std::begin( op_names )] = std::stod( item.substr( equal + 1 ) );
+        }
+        return mix;
+    }
+
+    options parse( int argc, char** argv )
+    {
+        options opts;
+        for ( int i = 1; i < argc; i++ ) {
+            const std::string arg = argv[i];
+            const auto value = [&]() -> std::string {
+                if ( i + 1 >= argc ) throw std::runtime_error( "missing value for " + arg );
+                return argv[++i];
+            };
+            if ( arg == "--endpoint" ) opts.endpoint = value();
+            else if ( arg == "--key" ) opts.key = value();
+            else if ( arg == "--prefix" ) opts.prefix = value();
+            else if ( arg == "--code" ) opts.code = value();
+            else if ( arg == "--token" ) opts.token = value();
+            else if ( arg == "--accounts" ) opts.accounts = std::stoul( value() );
+            else if ( arg == "--fund" ) opts.fund = parse_amount( value() );
+            else if ( arg == "--deposit" ) opts.deposit = parse_amount( value() );
+            else if ( arg == "--batch" ) opts.batch = std::max( 1ul, std::stoul( value() ) );
+            else if ( arg == "--threads" ) opts.threads = std::max( 1ul, std::stoul( value() ) );
+            else if ( arg == "--rate" ) opts.rate = std::stod( value() );
+            else if ( arg == "--duration" ) opts.duration = std::stod( value() );
+            else if ( arg == "--mix" ) opts.mix = parse_mix( value() );
+            else if ( arg == "--hot-accounts" ) opts.hot_accounts = std::stod( value() );
+            else if ( arg == "--hot-share" ) opts.hot_share = std::stod( value() );
+            else if ( arg == "--seed" ) opts.seed = std::stoull( value() );
+            else if ( arg == "--no-blocks" ) opts.blocks = false;
+            else if ( opts.command.empty() ) opts.command = arg;
+            else throw std::runtime_error( "unexpected argument: " + arg );
+        }
+        if ( opts.prefix.empty() || opts.prefix.size() > 6 ) throw std::runtime_error( "--prefix must have 1 to 6 characters" );
+        if ( opts.accounts == 0 ) throw std::runtime_error( "--accounts must be positive" );
+        return opts;
+    }
+
+    // <prefix> + 6 letters: "lgaaaaaa", "lgaaaaab", ...
+    uint64_t account_name( const options& opts, uint32_t index )
+    {
+        std::string str( 6, 'a' );
+        for ( int i = 5; i >= 0; i--, index /= 26 ) str[i] += index % 26;
+        return string_to_name( opts.prefix + str );
+    }
+
+    // names & symbols resolved once from the options
+    struct context {
+        uint64_t    eosio = string_to_name( "eosio" );
+        uint64_t    active = string_to_name( "active" );
+        uint64_t    code;
+        uint64_t    token;
+        uint64_t    sym;
+        uint64_t    open_sym;
+
+        explicit context( const options& opts )
+            : code( string_to_name( opts.code ) ),
+              token( string_to_name( opts.token ) ),
+              sym( string_to_symbol( 4, opts.symcode ) ),
+              open_sym( string_to_symbol( 4, opts.open_symcode ) )
+        {}
+
+        action transfer( uint64_t from, uint64_t to, int64_t amount, std::string_view memo ) const
+        {
+            packer p;
+            p.pack( from ).pack( to ).asset( amount, sym ).str( memo );
+            return { token, string_to_name( "transfer" ), { { from, active } }, p.data };
+        }
+
+        action withdraw( uint64_t account, int64_t amount ) const
+        {
+            packer p;
+            p.pack( account ).pack( token ).asset( amount, sym );
+            return { code, string_to_name( "withdraw" ), { { account, active } }, p.data };
+        }
+
+        action open( uint64_t account ) const
+        {
+            packer p;
+            p.pack( account ).pack( token ).pack( open_sym >> 8 ).pack( account );
+            return { code, string_to_name( "open" ), { { account, active } }, p.data };
+        }
+
+        action close( uint64_t account ) const
+        {
+            packer p;
+            p.pack( account ).pack( token ).pack( open_sym >> 8 );
+            return { code, string_to_name( "close" ), { { account, active } }, p.data };
+        }
+
+        // owner & active: single key, threshold 1
+        action newaccount( uint64_t account, const private_key& key ) const
+        {
+            packer p;
+            p.pack( eosio ).pack( account );
+            for ( int i = 0; i < 2; i++ ) {
+                p.pack<uint32_t>( 1 ).varuint32( 1 );
+                p.varuint32( 0 ).raw( key.public_key().data(), key.public_key().size() ).pack<uint16_t>( 1 );
+                p.varuint32( 0 ).varuint32( 0 );
+            }
+            return { eosio, string_to_name( "newaccount" ), { { eosio, active } }, p.data };
+        }
+
+        action create_token( int64_t maximum_supply ) const
+        {
+            packer p;
+            p.pack( eosio ).asset( maximum_supply, open_sym );
+            return { token, string_to_name( "create" ), { { token, active } }, p.data };
+        }
+    };
+
+    response push( client& http, private_key& key, const std::vector<action>& actions )
+    {
+        const chain_state state = read_chain_state( http.get_info() );
+        return http.post( push_target, signed_transaction( key, state, pack_transaction( state.head_block_time + 60, state, actions ) ) );
+    }
+
+    /**
+     * Push `make(i)` for every account, `--batch` actions per transaction. A failed batch is retried one action
+     * at a time so a rerun skips accounts already done (failures containing `ignore`).
+     */
+    template <typename Make>
+    void for_each_account( const options& opts, client& http, private_key& key, const char* label, const std::string& ignore, Make make )
+    {
+        uint32_t done = 0;
+        uint32_t skipped = 0;
+        for ( uint32_t i = 0; i < opts.accounts; i += opts.batch ) {
+            std::vector<action> actions;
+            for ( uint32_t j = i; j < std::min( opts.accounts, i + opts.batch ); j++ ) actions.push_back( make( j ) );
+            if ( push( http, key, actions ).ok() ) {
+                done += actions.size();
+                continue;
+            }
+            for ( const action& act : actions ) {
+                const response res = push( http, key, { act } );
+                const std::string reason = res.ok() ? "" : failure_reason( res.body );
+                if ( res.ok() ) done++;
+                else if ( !ignore.empty() && reason.find( ignore ) != std::string::npos ) skipped++;
+                else throw std::runtime_error( std::string( label ) + ": " + reason );
+            }
+        }
+        fprintf( stderr, "%-10s %u done, %u skipped\n", label, done, skipped );
+    }
+
+    int setup( const options& opts )
+    {
+        const context ctx( opts );
+        private_key key( opts.key );
+        client http( opts.endpoint );
+        fprintf( stderr, "setup %u accounts (%s...) with key %s\n", opts.accounts, opts.prefix.c_str(), key.public_key_string().c_str() );
+
+        for_each_account( opts, http, key, "accounts", "already taken", [&]( uint32_t i ) {
+            return ctx.newaccount( account_name( opts, i ), key );
+        });
+
+        // `open` & `close` token: a `stat` row is all `open` needs, nothing is ever issued
+        const response created = push( http, key, { ctx.create_token( 10000000000000 ) } );
+        const std::string reason = created.ok() ? "" : failure_reason( created.body );
+        if ( !created.ok() && reason.find( "already exists" ) == std::string::npos ) throw std::runtime_error( "create " + opts.open_symcode + ": " + reason );
+
+        if ( opts.fund > 0 ) {
+            for_each_account( opts, http, key, "fund", "", [&]( uint32_t i ) {
+                return ctx.transfer( ctx.eosio, account_name( opts, i ), opts.fund, "loadgen" );
+            });
+        }
+        if ( opts.deposit > 0 ) {
+            for_each_account( opts, http, key, "deposit", "", [&]( uint32_t i ) {
+                return ctx.transfer( account_name( opts, i ), ctx.code, opts.deposit, "" );
+            });
+        }
+        return 0;
+    }
+
+    struct worker_stats {
+        std::array<uint64_t, op_count>      sent = {};
+        std::array<uint64_t, op_count>      accepted = {};
+        std::map<std::string, uint64_t>     failures;               // "<op>: <reason>"
+        std::vector<uint32_t>               latency_us;
+    };
+
+    struct shared {
+        std::mutex                          mutex;
+        chain_state                         state;                  // latest TaPoS, refreshed by the main thread
+        std::atomic<uint64_t>               nonce{ 0 };
+        std::vector<std::atomic<uint8_t>>   opened;                 // `open_symcode` balance opened by this run
+        std::atomic<bool>                   stop{ false };
+
+        explicit shared( uint32_t accounts ) : opened( accounts ) {}
+
+        chain_state tapos()
+        {
+            std::lock_guard<std::mutex> lock( mutex );
+            return state;
+        }
+    };
+
+    /**
+     * Push one action per transaction until stopped, paced at `--rate / --threads` when rate limited.
+     *
+     * Transactions must be unique: expiration is offset by the nonce (within the 1 hour maximum),
+     * deposit memos and withdrawn amounts carry it too. Memos start with `#`, never routed to another account.
+     */
+    void worker( const options& opts, const context& ctx, shared& s, uint32_t id, worker_stats& stats )
+    {
+        private_key key( opts.key );
+        client http( opts.endpoint );
+        std::mt19937_64 rng( opts.seed * 1000003 + id );
+        std::discrete_distribution<int> pick_op( opts.mix.begin(), opts.mix.end() );
+        std::uniform_real_distribution<double> unit( 0, 1 );
+        const uint32_t hot = std::max( 1u, uint32_t( opts.accounts * opts.hot_accounts ) );
+
+        using clock = std::chrono::steady_clock;
+        const auto interval = std::chrono::duration_cast<clock::duration>( std::chrono::duration<double>( opts.rate > 0 ? opts.threads / opts.rate : 0 ) );
+        auto next = clock::now();
+
+        while ( !s.stop ) {
+            if ( opts.rate > 0 ) {
+                std::this_thread::sleep_until( next );
+                next = std::max( next + interval, clock::now() - std::chrono::seconds( 1 ) );
+            }
+            const uint64_t nonce = s.nonce++;
+
+            // hot accounts take `--hot-share` of the load, the rest is spread over every account
+            const uint32_t index = unit( rng ) < opts.hot_share
+                ? std::uniform_int_distribution<uint32_t>( 0, hot - 1 )( rng )
+                : std::uniform_int_distribution<uint32_t>( 0, opts.accounts - 1 )( rng );
+            const uint64_t account = account_name( opts, index );
+            const int64_t amount = 1 + nonce % 100;
+
+            // only close what was opened, otherwise open it first
+            op kind = op( pick_op( rng ) );
+            if ( kind == op_close && !s.opened[index] ) kind = op_open;
+
+            action act;
+            if ( kind == op_deposit ) act = ctx.transfer( account, ctx.code, amount, "#" + std::to_string( nonce ) );
+            else if ( kind == op_withdraw ) act = ctx.withdraw( account, amount );
+            else if ( kind == op_open ) act = ctx.open( account );
+            else act = ctx.close( account );
+
+            const chain_state state = s.tapos();
+            const std::string body = signed_transaction( key, state, pack_transaction( state.head_block_time + 60 + nonce % 3000, state, { act } ) );
+
+            const auto start = clock::now();
+            stats.sent[kind]++;
+            try {
+                const response res = http.post( push_target, body );
+                stats.latency_us.push_back( std::chrono::duration_cast<std::chrono::microseconds>( clock::now() - start ).count() );
+                if ( res.ok() ) {
+                    stats.accepted[kind]++;
+                    if ( kind == op_open ) s.opened[index] = 1;
+                    if ( kind == op_close ) s.opened[index] = 0;
+                } else {
+                    stats.failures[std::string( op_names[kind] ) + ": " + failure_reason( res.body )]++;
+                }
+            } catch ( const std::exception& e ) {
+                stats.failures[std::string( op_names[kind] ) + ": " + e.what()]++;
+            }
+        }
+    }
+
+    // wallet.sx actions of one block, by op
+    struct block_count {
+        uint32_t                        block_num;
+        uint32_t                        transactions = 0;
+        uint32_t                        actions = 0;
+        std::array<uint32_t, op_count>  ops = {};
+    };
+
+    block_count count_block( const options& opts, client& http, uint32_t block_num )
+    {
+        block_count count{ block_num };
+        const json block = http.get_block( block_num );
+        const auto transactions = block.get_child_optional( "transactions" );
+        if ( !transactions ) return count;
+
+        for ( const auto& [_, receipt] : *transactions ) {
+            count.transactions++;
+            // deferred transactions only carry their id
+            const auto actions = receipt.get_child_optional( "trx.transaction.actions" );
+            if ( !actions ) continue;
+            for ( const auto& [_, act] : *actions ) {
+                count.actions++;
+                const std::string account = act.get<std::string>( "account" );
+                const std::string name = act.get<std::string>( "name" );
+                if ( account == opts.token && name == "transfer" && act.get<std::string>( "data.to", "" ) == opts.code ) count.ops[op_deposit]++;
+                else if ( account == opts.code && name == "withdraw" ) count.ops[op_withdraw]++;
+                else if ( account == opts.code && name == "open" ) count.ops[op_open]++;
+                else if ( account == opts.code && name == "close" ) count.ops[op_close]++;
+            }
+        }
+        return count;
+    }
+
+    void report_blocks( const options& opts, client& http, uint32_t first, uint32_t last )
+    {
+        printf( "\n%10s %8s %8s", "block", "trx", "actions" );
+        for ( const char* name : op_names ) printf( " %8s", name );
+        printf( "\n" );
+
+        uint64_t total = 0;
+        uint32_t peak = 0;
+        for ( uint32_t block_num = first; block_num <= last; block_num++ ) {
+            const block_count count = count_block( opts, http, block_num );
+            printf( "%10u %8u %8u", count.block_num, count.transactions, count.actions );
+            for ( const uint32_t n : count.ops ) printf( " %8u", n );
+            printf( "\n" );
+            total += count.actions;
+            peak = std::max( peak, count.actions );
+        }
+        const uint32_t blocks = last - first + 1;
+        printf( "\nblocks: %u, actions/block: %.1f avg, %u peak\n", blocks, double( total ) / blocks, peak );
+    }
+
+    int run( const options& opts )
+    {
+        const context ctx( opts );
+        client http( opts.endpoint );
+        shared s( opts.accounts );
+        s.state = read_chain_state( http.get_info() );
+        const uint32_t first_block = s.state.head_block_num + 1;
+
+        std::vector<worker_stats> stats( opts.threads );
+        std::vector<std::thread> workers;
+        const auto start = std::chrono::steady_clock::now();
+        for ( uint32_t i = 0; i < opts.threads; i++ ) {
+            workers.emplace_back( worker, std::cref( opts ), std::cref( ctx ), std::ref( s ), i, std::ref( stats[i] ) );
+        }
+
+        // refresh TaPoS every 500ms, each transaction references a block of the last ~2 seconds
+        const auto end = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>( std::chrono::duration<double>( opts.duration ) );
+        while ( std::chrono::steady_clock::now() < end ) {
+            std::this_thread::sleep_for( std::chrono::milliseconds( 500 ) );
+            const chain_state state = read_chain_state( http.get_info() );
+            std::lock_guard<std::mutex> lock( s.mutex );
+            s.state = state;
+        }
+        s.stop = true;
+        for ( auto& thread : workers ) thread.join();
+        const double elapsed = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+        const uint32_t last_block = read_chain_state( http.get_info() ).head_block_num;
+
+        // aggregate
+        worker_stats total;
+        for ( const worker_stats& w : stats ) {
+            for ( int i = 0; i < op_count; i++ ) {
+                total.sent[i] += w.sent[i];
+                total.accepted[i] += w.accepted[i];
+            }
+            for ( const auto& [reason, n] : w.failures ) total.failures[reason] += n;
+            total.latency_us.insert( total.latency_us.end(), w.latency_us.begin(), w.latency_us.end() );
+        }
+        std::sort( total.latency_us.begin(), total.latency_us.end() );
+        const auto percentile = [&]( double p ) {
+            return total.latency_us.empty() ? 0.0 : total.latency_us[size_t( p * ( total.latency_us.size() - 1 ) )] / 1000.0;
+        };
+
+        uint64_t sent = 0;
+        uint64_t accepted = 0;
+        printf( "threads: %u, accounts: %u (hot: %.0f%% of load on %.2f%%), rate: %.0f/s (0 = unlimited), elapsed: %.1fs\n\n",
+                opts.threads, opts.accounts, opts.hot_share * 100, opts.hot_accounts * 100, opts.rate, elapsed );
+        printf( "%-10s %10s %10s %10s %10s\n", "op", "sent", "accepted", "failed", "TPS" );
+        for ( int i = 0; i < op_count; i++ ) {
+            printf( "%-10s %10lu %10lu %10lu %10.1f\n", op_names[i], total.sent[i], total.accepted[i], total.sent[i] - total.accepted[i], total.accepted[i] / elapsed );
+            sent += total.sent[i];
+            accepted += total.accepted[i];
+        }
+        printf( "%-10s %10lu %10lu %10lu %10.1f\n", "total", sent, accepted, sent - accepted, accepted / elapsed );
+        printf( "\nlatency: p50 %.1fms, p99 %.1fms\n", percentile( 0.5 ), percentile( 0.99 ) );
+
+        if ( !total.failures.empty() ) {
+            std::vector<std::pair<uint64_t, std::string>> failures;
+            for ( const auto& [reason, n] : total.failures ) failures.emplace_back( n, reason );
+            std::sort( failures.rbegin(), failures.rend() );
+            printf( "\nfailures:\n" );
+            for ( const auto& [n, reason] : failures ) printf( "%10lu  %s\n", n, reason.c_str() );
+        }
+        if ( opts.blocks ) report_blocks( opts, http, first_block, last_block );
+        return 0;
+    }
+}
+
+int main( int argc, char** argv )
+{
+    try {
+        const options opts = parse( argc, argv );
+        if ( opts.command == "setup" ) return setup( opts );
+        if ( opts.command == "run" ) return run( opts );
+        throw std::runtime_error( "unknown command: " + opts.command );
+    } catch ( const std::exception& e ) {
+        fprintf( stderr, "error: %s\n", e.what() );
+        return 2;
+    }
+}
@@ -0,0 +1,148 @@
+#!/bin/bash
+
+# on-chain CPU/NET regression suite against the local single-producer nodeos
+#
+# usage: ./scripts/bench_chain.sh [options]
+#
+#   --runs <n>            transactions per workload (default: 50)
+#   --symbols <n>         symbols held by the account of the `deposit_many` workload (default: 50)
+#   --threshold <pct>     allowed p50 regression against baseline (default: 10)
+#   --baseline <file>     baseline report (default: bench/chain/baseline.json)
+#   --report <file>       output report (default: bench/chain/report.json)
+#   --update-baseline     store this run as the new baseline
+#   --no-restart          reuse running nodeos & deployed contracts
+
+RUNS=50
+SYMBOLS=50
+THRESHOLD=10
+BASELINE=bench/chain/baseline.json
+REPORT=bench/chain/report.json
+UPDATE_BASELINE=0
+RESTART=1
+
+while [ $# -gt 0 ]; do
+  case "$1" in
+    --runs) RUNS=$2; shift 2 ;;
+    --symbols) SYMBOLS=$2; shift 2 ;;
+    --threshold) THRESHOLD=$2; shift 2 ;;
+    --baseline) BASELINE=$2; shift 2 ;;
+    --report) REPORT=$2; shift 2 ;;
+    --update-baseline) UPDATE_BASELINE=1; shift ;;
+    --no-restart) RESTART=0; shift ;;
+    *) echo "unknown option: $1"; exit 2 ;;
+  esac
+done
+
+mkdir -p "$(dirname "$REPORT")"
+RAW=$(mktemp)
+trap 'rm -f "$RAW"' EXIT
+
+# boot nodeos & deploy
+if [ $RESTART -eq 1 ]; then
+  ./scripts/build.sh > /dev/null || exit 1
+  ./scripts/restart.sh > /dev/null 2>&1
+  sleep 1
+fi
+
+# record <workload> <cleos args...> - push transaction & keep billed CPU/NET from its trace
+record() {
+  local workload=$1; shift
+  local trace
+  trace=$(cleos "$@" -f --json 2> /dev/null)
+  if [ -z "$trace" ]; then
+    echo "failed: $workload: cleos $*" >&2
+    return
+  fi
+  echo "$trace" | jq -c --arg workload "$workload" \
+    '{ workload: $workload, cpu: .processed.receipt.cpu_usage_us, net: .processed.net_usage }' >> "$RAW"
+}
+
+# symbol <prefix> <index> - upper-case symbol code from an index (ex: MSAAB)
+symbol() {
+  local code=$1 i=$2
+  for _ in 1 2 3; do
+    code+=$(printf "\\$(printf '%03o' $((65 + i % 26)))")
+    i=$((i / 26))
+  done
+  echo "$code"
+}
+
+# token <symbol> - create, issue & fund myaccount
+token() {
+  cleos push action eosio.token create "[\"eosio\", \"1000000000.0000 $1\"]" -p eosio.token > /dev/null 2>&1
+  cleos push action eosio.token issue "[\"eosio\", \"1000000.0000 $1\", \"init\"]" -p eosio > /dev/null 2>&1
+  cleos transfer eosio myaccount "100000.0000 $1" "init" > /dev/null 2>&1
+}
+
+echo "workloads: $RUNS runs, $SYMBOLS symbols"
+
+# deposits & withdraws (balances opened first for `strict-open` builds)
+cleos push action wallet.sx open '["myaccount", "eosio.token", "EOS", "myaccount"]' -p myaccount > /dev/null
+cleos push action wallet.sx open '["toaccount", "eosio.token", "EOS", "toaccount"]' -p toaccount > /dev/null
+cleos transfer myaccount wallet.sx "1000.0000 EOS" "init" > /dev/null
+for i in $(seq 1 "$RUNS"); do
+  record deposit transfer myaccount wallet.sx "0.0001 EOS" ""
+  record withdraw push action wallet.sx withdraw '["myaccount", "eosio.token", "0.0001 EOS"]' -p myaccount
+  record move push action wallet.sx move '["myaccount", "toaccount", "eosio.token", "0.0001 EOS", ""]' -p myaccount
+done
+
+# open/close churn (fresh symbol per run)
+for i in $(seq 1 "$RUNS"); do
+  SYMBOL=$(symbol OC "$i")
+  cleos push action eosio.token create "[\"eosio\", \"1000000.0000 $SYMBOL\"]" -p eosio.token > /dev/null 2>&1
+  record open push action wallet.sx open "[\"toaccount\", \"eosio.token\", \"$SYMBOL\", \"myaccount\"]" -p myaccount
+  record close push action wallet.sx close "[\"toaccount\", \"eosio.token\", \"$SYMBOL\"]" -p toaccount
+done
+
+# account holding many symbols of the same token contract
+for i in $(seq 0 $((SYMBOLS - 1))); do
+  SYMBOL=$(symbol MS "$i")
+  token "$SYMBOL"
+  cleos push action wallet.sx open "[\"myaccount\", \"eosio.token\", \"$SYMBOL\", \"myaccount\"]" -p myaccount > /dev/null 2>&1
+  cleos transfer myaccount wallet.sx "1.0000 $SYMBOL" "init" > /dev/null 2>&1
+done
+for i in $(seq 1 "$RUNS"); do
+  SYMBOL=$(symbol MS $((i % SYMBOLS)))
+  record deposit_many transfer myaccount wallet.sx "0.0001 $SYMBOL" ""
+  record withdraw_many push action wallet.sx withdraw "[\"myaccount\", \"eosio.token\", \"0.0001 $SYMBOL\"]" -p myaccount
+done
+
+# percentiles per workload
+jq -s '
+  def pct($p): sort | .[((length - 1) * $p / 100 | floor)];
+  def stats: { p50: pct(50), p90: pct(90), p99: pct(99), max: max, mean: (add / length | floor) };
+  group_by(.workload) | map({
+    key: .[0].workload,
+    value: { runs: length, cpu_usage_us: (map(.cpu) | stats), net_usage: (map(.net) | stats) }
+  }) | from_entries
+' "$RAW" > "$REPORT"
+
+jq -r 'to_entries[] | "\(.key)\tcpu p50 \(.value.cpu_usage_us.p50)us p90 \(.value.cpu_usage_us.p90)us\tnet p50 \(.value.net_usage.p50)B"' "$REPORT" | column -t -s $'\t'
+echo "report: $REPORT"
+
+if [ $UPDATE_BASELINE -eq 1 ]; then
+  cp "$REPORT" "$BASELINE"
+  echo "baseline updated: $BASELINE"
+  exit 0
+fi
+
+if [ ! -f "$BASELINE" ]; then
+  echo "no baseline found ($BASELINE), run with --update-baseline to create one"
+  exit 0
+fi
+
+# fail on p50 CPU or NET regressions above threshold
+REGRESSIONS=$(jq -r --slurpfile baseline "$BASELINE" --argjson threshold "$THRESHOLD" '
+  to_entries[] | .key as $workload | .value as $current | $baseline[0][$workload] as $base
+  | select($base != null)
+  | ( ["cpu_usage_us", "net_usage"][] ) as $metric
+  | select($current[$metric].p50 > $base[$metric].p50 * (1 + $threshold / 100))
+  | "\($workload) \($metric) p50 \($base[$metric].p50) -> \($current[$metric].p50)"
+' "$REPORT")
+
+if [ -n "$REGRESSIONS" ]; then
+  echo "regressions above ${THRESHOLD}%:"
+  echo "$REGRESSIONS"
+  exit 1
+fi
+echo "no regressions above ${THRESHOLD}%"
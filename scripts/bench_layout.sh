@@ -0,0 +1,7 @@
+#!/bin/bash
+
+# RAM per holder & single balance update cost of the legacy `balances`, per-symbol & compact `amounts` layouts
+# usage: ./scripts/bench_layout.sh [iterations=200000] [holders=1000]
+
+g++ -std=c++17 -O2 -Wno-attributes $CXXFLAGS -I bench -I include bench/layout.cpp -o bench/wallet.sx.layout || exit 1
+./bench/wallet.sx.layout "$@"
@@ -0,0 +1,7 @@
+#!/bin/bash
+
+# native micro-benchmark of wallet.sx against host-side CDT stand-ins (no nodeos required)
+# usage: [CXXFLAGS="-DWALLET_NOTIFY=0"] ./scripts/bench_native.sh [iterations=1000000] [users=1000] [symbols=1]
+
+g++ -std=c++17 -O2 -Wno-attributes $CXXFLAGS -I bench -I include bench/bench.cpp -o bench/wallet.sx.bench || exit 1
+./bench/wallet.sx.bench "$@"
@@ -0,0 +1,36 @@
+#!/bin/bash
+
+# compares billed CPU of N `withdraw` actions against a single `withdrawbatch` action
+# usage: ./scripts/bench_withdrawbatch.sh [count=10] (requires ./scripts/restart.sh)
+
+COUNT=${1:-10}
+SYMBOLS=(AAA BBB CCC DDD EEE FFF GGG HHH III JJJ KKK LLL MMM NNN OOO PPP QQQ RRR SSS TTT)
+SYMBOLS=("${SYMBOLS[@]:0:$COUNT}")
+
+# create tokens & deposit 2 rounds worth of balances
+for SYMBOL in "${SYMBOLS[@]}"; do
+  cleos push action eosio.token create "[\"eosio\", \"1000000.0000 $SYMBOL\"]" -p eosio.token > /dev/null 2>&1
+  cleos push action eosio.token issue "[\"eosio\", \"1000.0000 $SYMBOL\", \"init\"]" -p eosio > /dev/null
+  cleos transfer eosio myaccount "10.0000 $SYMBOL" "init" > /dev/null
+  cleos transfer myaccount wallet.sx "2.0000 $SYMBOL" > /dev/null
+done
+
+# N x withdraw (single transaction)
+ACTIONS=$(for SYMBOL in "${SYMBOLS[@]}"; do
+  jq -nc --arg symbol "$SYMBOL" '{
+    account: "wallet.sx", name: "withdraw",
+    authorization: [{ actor: "myaccount", permission: "active" }],
+    data: { account: "myaccount", contract: "eosio.token", quantity: ("1.0000 " + $symbol) }
+  }'
+done | jq -sc .)
+SINGLE=$(cleos push transaction "{\"actions\": $ACTIONS}" --json | jq '.processed.receipt.cpu_usage_us')
+
+# 1 x withdrawbatch
+QUANTITIES=$(for SYMBOL in "${SYMBOLS[@]}"; do
+  jq -nc --arg symbol "$SYMBOL" '{ contract: "eosio.token", quantity: ("1.0000 " + $symbol) }'
+done | jq -sc .)
+BATCH=$(cleos push action wallet.sx withdrawbatch "[\"myaccount\", $QUANTITIES]" -p myaccount --json | jq '.processed.receipt.cpu_usage_us')
+
+echo "symbols: $COUNT"
+echo "withdraw x $COUNT: $SINGLE us"
+echo "withdrawbatch x 1: $BATCH us"
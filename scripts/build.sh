@@ -1,7 +1,50 @@
 #!/bin/bash
 
-eosio-cpp wallet.sx.cpp -I include
-cleos set contract wallet.sx . wallet.sx.wasm wallet.sx.abi
+# usage: ./scripts/build.sh                      build & deploy contracts
+#        ./scripts/build.sh variants [--bench]   build every policy variant into build/<variant>, report WASM size
+#                                                (--bench: per-action CPU of each variant on local nodeos)
 
-eosio-cpp examples/basic.cpp -I include
-cleos set contract basic . basic.wasm basic.abi
+# compile-time policies of each variant (see `sx::policy` in wallet.sx.hpp)
+VARIANTS="default strict-open no-notify self-pays-ram stats lean"
+flags() {
+  case "$1" in
+    strict-open) echo "-DWALLET_STRICT_OPEN=1" ;;
+    no-notify) echo "-DWALLET_NOTIFY=0" ;;
+    self-pays-ram) echo "-DWALLET_SELF_PAYS_RAM=1" ;;
+    stats) echo "-DWALLET_STATS=1" ;;
+    lean) echo "-DWALLET_STRICT_OPEN=1 -DWALLET_NOTIFY=0 -DWALLET_SELF_PAYS_RAM=1" ;;
+  esac
+}
+
+if [ "$1" != "variants" ]; then
+  eosio-cpp wallet.sx.cpp -I include
+  cleos set contract wallet.sx . wallet.sx.wasm wallet.sx.abi
+
+  eosio-cpp examples/basic.cpp -I include
+  cleos set contract basic . basic.wasm basic.abi
+  exit 0
+fi
+
+for VARIANT in $VARIANTS; do
+  mkdir -p "build/$VARIANT"
+  eosio-cpp wallet.sx.cpp -I include $(flags "$VARIANT") -o "build/$VARIANT/wallet.sx.wasm" || exit 1
+done
+
+if [ "$2" == "--bench" ]; then
+  eosio-cpp examples/basic.cpp -I include
+  eosio-cpp wallet.sx.cpp -I include
+  for VARIANT in $VARIANTS; do
+    ./scripts/restart.sh > /dev/null 2>&1
+    cleos set contract wallet.sx "build/$VARIANT" wallet.sx.wasm wallet.sx.abi > /dev/null || exit 1
+    ./scripts/bench_chain.sh --no-restart --report "build/$VARIANT/report.json" > /dev/null
+  done
+fi
+
+# summary: WASM size (bytes) & p50 CPU per workload
+for VARIANT in $VARIANTS; do
+  LINE=$(printf "%-16s %8s bytes" "$VARIANT" "$(stat -c %s "build/$VARIANT/wallet.sx.wasm")")
+  if [ "$2" == "--bench" ]; then
+    LINE+=$(jq -r 'to_entries | map("  \(.key) \(.value.cpu_usage_us.p50)us") | join("")' "build/$VARIANT/report.json")
+  fi
+  echo "$LINE"
+done
@@ -0,0 +1,4 @@
+#!/bin/bash
+
+# state-history indexer (requires boost >= 1.70 for beast websocket)
+g++ -std=c++17 -O2 -Wall indexer/main.cpp -o indexer/wallet.sx.indexer -lpthread
@@ -0,0 +1,4 @@
+#!/bin/bash
+
+# transaction load generator (boost beast http, openssl libcrypto for secp256k1 signing)
+g++ -std=c++17 -O2 -Wall loadgen/main.cpp -o loadgen/wallet.sx.loadgen -lpthread -lcrypto
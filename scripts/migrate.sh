@@ -0,0 +1,28 @@
+#!/bin/bash
+
+# migrate legacy `balances` rows into `amounts` in bounded chunks
+# usage: ./scripts/migrate.sh [legacy rows per transaction=500] [accounts per queue transaction=100]
+
+ROWS=${1:-500}
+BATCH=${2:-100}
+
+# queue every scope of the legacy layout (accounts already queued are skipped)
+LOWER=""
+while true; do
+  SCOPES=$(cleos get scope wallet.sx -t balances -l "$BATCH" -L "$LOWER")
+  ACCOUNTS=$(echo "$SCOPES" | jq -c '[.rows[].scope]')
+  if [ "$ACCOUNTS" != "[]" ]; then
+    cleos push action wallet.sx queuemigrate "[$ACCOUNTS]" -p wallet.sx > /dev/null || exit 1
+    echo "queued $(echo "$ACCOUNTS" | jq length) accounts"
+  fi
+  LOWER=$(echo "$SCOPES" | jq -r '.more')
+  [ -z "$LOWER" ] && break
+done
+
+# drain the queue
+while true; do
+  RESULT=$(cleos push action wallet.sx migrate "[$ROWS]" -p wallet.sx -f --json | jq -c '.processed.action_traces[0].return_value_data')
+  echo "migrated: $RESULT"
+  [ "$(echo "$RESULT" | jq -r '.done')" == "true" ] && break
+  [ -z "$RESULT" ] && exit 1
+done
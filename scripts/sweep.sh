@@ -0,0 +1,13 @@
+#!/bin/bash
+
+# erase zero balances of every registered account in bounded chunks, reclaiming RAM
+# usage: ./scripts/sweep.sh [rows per transaction=500]
+
+ROWS=${1:-500}
+
+while true; do
+  RESULT=$(cleos push action wallet.sx sweep "[$ROWS]" -p wallet.sx -f --json | jq -c '.processed.action_traces[0].return_value_data')
+  echo "swept: $RESULT"
+  [ "$(echo "$RESULT" | jq -r '.done')" == "true" ] && break
+  [ -z "$RESULT" ] && exit 1
+done
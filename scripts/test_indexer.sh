@@ -0,0 +1,36 @@
+#!/bin/bash
+
+# sync the state-history indexer against the local nodeos & compare with `getportfolio`
+INDEX=./nodeos/wallet.sx.index
+INDEXER=./indexer/wallet.sx.indexer
+
+./scripts/build_indexer.sh || exit 1
+./scripts/restart.sh > /dev/null 2>&1
+./scripts/test.sh > /dev/null 2>&1
+sleep 2
+
+rm -f "$INDEX"
+$INDEXER sync --index "$INDEX" --exit-at-lib || exit 1
+
+# resume from committed block (no-op once synced)
+cleos transfer myaccount wallet.sx "1.0000 EOS" > /dev/null
+sleep 2
+$INDEXER sync --index "$INDEX" --exit-at-lib || exit 1
+
+# compact `amounts` entries & legacy `balances` decoded by the contract itself
+PORTFOLIO='.processed.action_traces[0].return_value_data.balances[] | "\(.contract) \(.quantity)"'
+
+FAILED=0
+for ACCOUNT in myaccount basic; do
+  EXPECTED=$(cleos push action wallet.sx getportfolio "[\"$ACCOUNT\", 0, 1000, \"\", \"\"]" --read-only --json | jq -r "$PORTFOLIO" | sort)
+  ACTUAL=$($INDEXER account "$ACCOUNT" --index "$INDEX" | awk '{ print $2, $3, $4 }' | sort)
+  if [ "$EXPECTED" == "$ACTUAL" ]; then
+    echo "ok: $ACCOUNT"
+  else
+    echo "mismatch: $ACCOUNT"
+    echo "  chain:   $EXPECTED"
+    echo "  indexer: $ACTUAL"
+    FAILED=1
+  fi
+done
+exit $FAILED
@@ -0,0 +1,7 @@
+#!/bin/bash
+
+# native behavior tests of wallet.sx against host-side CDT stand-ins (no nodeos required)
+# usage: [CXXFLAGS="-DWALLET_STRICT_OPEN=1"] ./scripts/test_native.sh
+
+g++ -std=c++17 -O1 -Wno-attributes $CXXFLAGS -I bench -I include bench/test.cpp -o bench/wallet.sx.test || exit 1
+./bench/wallet.sx.test
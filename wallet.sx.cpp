@@ -1,42 +1,559 @@
-#include <eosio.token/eosio.token.hpp>
 #include "wallet.sx.hpp"
 
 [[eosio::on_notify("*::transfer")]]
-void sx::wallet::on_transfer( const name from, const name to, const asset quantity, const string memo )
+void sx::wallet::on_transfer( const name from, const name to, const asset quantity, const string& memo )
 {
     require_auth( from );
 
     // ignore no-incoming transfers
     if ( to != get_self() ) return;
 
-    // update balance
+    // validate token precision against cached symbol (transferred symbol if token has no `stat` table)
     const name contract = get_first_receiver();
-    add_balance( from, contract, quantity, get_self() );
+    check( get_token_symbol( contract, quantity.symbol.code(), get_self(), quantity.symbol ) == quantity.symbol, "symbol precision mismatch" );
 
-    // // (OPTIONAL) account must already have open balance (prevents exploiting RAM)
-    // check_open_internal( account, contract, quantity.symbol.code() );
+    // credit memo account (`<account>[:<tags>]`) when it exists, otherwise sender
+    const optional<memo_route> route = parse_memo( memo );
+    const bool routed = route && route->account != from && is_account( route->account );
+    const name account = routed ? route->account : from;
+
+    // update balance (memo account or any account with `strict_open` policy must have `open` balance)
+    const bool created = add_balance( account, contract, quantity, get_self(), routed || policy::strict_open );
+    add_liability( contract, quantity );
+
+    if constexpr ( policy::stats ) {
+        const token_stats delta = { contract, quantity.symbol.code(), quantity.amount, 1, 0, created, 0 };
+        log_stats( &delta, 1 );
+    }
 
     // deposit log (notification purposes only)
-    sx::wallet::deposit_action deposit( get_self(), { get_self(), "active"_n });
-    deposit.send( from, contract, quantity );
+    if constexpr ( !policy::notify ) return;
+    const sx::wallet::params settings = sx::wallet::settings( get_self(), get_self().value ).get_or_default();
+    if ( settings.notify == "inline"_n ) {
+        sx::wallet::deposit_action deposit( get_self(), { get_self(), "active"_n });
+        deposit.send( account, contract, quantity );
+    } else if ( settings.notify == "aggregated"_n ) {
+        log_deposit( contract, quantity, settings.log_size );
+    }
+}
+
+[[eosio::action]]
+void sx::wallet::setsettings( const optional<sx::wallet::params> settings )
+{
+    require_auth( get_self() );
+    sx::wallet::settings _settings( get_self(), get_self().value );
+
+    // clear settings (defaults to inline notifications)
+    if ( !settings ) return _settings.remove();
+
+    const set<name> modes = { "inline"_n, "none"_n, "aggregated"_n };
+    check( modes.count( settings->notify ), "notify must be `inline`, `none` or `aggregated`" );
+    check( settings->log_size > 0, "log_size must be positive" );
+    _settings.set( *settings, get_self() );
+}
+
+[[eosio::action]]
+void sx::wallet::refreshtoken( const name contract, const symbol_code symcode )
+{
+    require_auth( get_self() );
+
+    sx::wallet::tokens _tokens( get_self(), get_self().value );
+    const auto itr = _tokens.find( balance_key( contract, symcode ) );
+    if ( itr == _tokens.end() ) {
+        get_token_symbol( contract, symcode, get_self() );
+        return;
+    }
+
+    // retrieve token precision directly from token contract
+    const symbol sym = token::get_supply( contract, symcode ).symbol;
+    _tokens.modify( itr, get_self(), [&]( auto& row ) {
+        row.sym = extended_symbol{ sym, contract };
+    });
+}
+
+[[eosio::action]]
+void sx::wallet::evicttoken( const name contract, const symbol_code symcode )
+{
+    require_auth( get_self() );
+
+    sx::wallet::tokens _tokens( get_self(), get_self().value );
+    const auto & itr = _tokens.get( balance_key( contract, symcode ), "token is not cached" );
+
+    // balances of evicted tokens fall back to the token contract precision
+    token::stats _stats( contract, symcode.raw() );
+    check( _stats.find( symcode.raw() ) != _stats.end(), "token symbol does not exist" );
+    _tokens.erase( itr );
+}
+
+[[eosio::action]]
+void sx::wallet::setliability( const name contract, const symbol_code symcode )
+{
+    require_auth( get_self() );
+
+    sx::wallet::liabilities _liabilities( get_self(), get_self().value );
+    const auto itr = _liabilities.find( balance_key( contract, symcode ) );
+
+    // token without any balance yet, liabilities start at zero
+    if ( itr == _liabilities.end() ) {
+        const symbol sym = get_token_symbol( contract, symcode, get_self() );
+        _liabilities.emplace( get_self(), [&]( auto& row ) {
+            row.id = balance_key( contract, symcode );
+            row.contract = contract;
+            row.supply = asset{ 0, sym };
+            row.seeded = true;
+        });
+        return;
+    }
+    check( itr->contract == contract && itr->supply.symbol.code() == symcode, "token key collision" );
+    check( !itr->seeded, "liabilities already seeded" );
+    _liabilities.modify( itr, same_payer, [&]( auto& row ) {
+        row.seeded = true;
+    });
+}
+
+[[eosio::action, eosio::read_only]]
+sx::wallet::solvency_result sx::wallet::solvency( const name contract, const symbol_code symcode )
+{
+    sx::wallet::liabilities _liabilities( get_self(), get_self().value );
+    const auto & row = _liabilities.get( balance_key( contract, symcode ), "no liabilities found" );
+    check( row.seeded, "liabilities are not seeded (see `setliability`)" );
+
+    // wallet token balance (zero if wallet has no token account)
+    token::accounts _accounts( contract, get_self().value );
+    const auto itr = _accounts.find( symcode.raw() );
+    const asset holdings = itr == _accounts.end() ? asset{ 0, row.supply.symbol } : itr->balance;
+
+    return { row.supply, holdings, holdings.amount >= row.supply.amount };
+}
+
+[[eosio::action, eosio::read_only]]
+sx::wallet::holders_page sx::wallet::getholders( const name contract, const uint128_t cursor, const uint32_t limit )
+{
+    check( limit > 0 && limit <= 1000, "limit must be between 1 and 1000" );
+
+    holders_page page{ {}, 0 };
+    page.holders.reserve( limit );
+
+    // all accounts by first seen time, cursor is a `byfirstseen` key (the account may be gone since)
+    if ( !contract ) {
+        sx::wallet::accounts _accounts( get_self(), get_self().value );
+        auto index = _accounts.get_index<"byfirstseen"_n>();
+        auto itr = index.lower_bound( cursor );
+
+        for ( ; itr != index.end() && page.holders.size() < limit; ++itr ) {
+            page.holders.push_back( { itr->account, itr->balances } );
+        }
+        if ( itr != index.end() ) page.next = itr->by_first_seen();
+        return page;
+    }
+
+    // token contract holders by account name
+    sx::wallet::holders _holders( get_self(), contract.value );
+    for ( auto itr = _holders.lower_bound( static_cast<uint64_t>( cursor ) ); itr != _holders.end(); ++itr ) {
+        if ( page.holders.size() == limit ) {
+            page.next = itr->account.value;
+            break;
+        }
+        page.holders.push_back( { itr->account, itr->balances } );
+    }
+    return page;
+}
+
+[[eosio::action, eosio::read_only]]
+sx::wallet::portfolio_page sx::wallet::getportfolio( const name account, const uint128_t cursor, const uint32_t limit, const name contract, const symbol_code symcode )
+{
+    check( limit > 0 && limit <= 1000, "limit must be between 1 and 1000" );
+
+    sx::wallet::amounts _amounts( get_self(), account.value );
+    sx::wallet::tokens _tokens( get_self(), get_self().value );
+    sx::wallet::balances _balances( get_self(), account.value );
+
+    portfolio_page page{ {}, 0 };
+    page.balances.reserve( limit );
+
+    // both layouts are keyed by token contract (a contract is in only one of them), merged in contract order
+    const uint64_t start = static_cast<uint64_t>( cursor >> 64 );
+    const uint64_t first = contract && contract.value > start ? contract.value : start;
+    auto amount = _amounts.lower_bound( first );
+    auto legacy = _balances.lower_bound( first );
+    while ( amount != _amounts.end() || legacy != _balances.end() ) {
+        const bool is_amount = amount != _amounts.end() && ( legacy == _balances.end() || amount->contract < legacy->contract );
+        const name row_contract = is_amount ? amount->contract : legacy->contract;
+        if ( contract && row_contract != contract ) break;
+
+        // balances of a row are ordered by symbol code, the cursor row resumes from the cursor symbol code
+        const uint64_t from = row_contract.value == start ? static_cast<uint64_t>( cursor ) : 0;
+        const auto skip = [&]( const symbol_code code ) {
+            return code.raw() < from || ( symcode.raw() && code != symcode );
+        };
+        const auto add = [&]( const asset& balance ) {
+            if ( page.balances.size() == limit ) {
+                page.next = static_cast<uint128_t>( row_contract.value ) << 64 | balance.symbol.code().raw();
+                return false;
+            }
+            page.balances.push_back( extended_asset{ balance, row_contract } );
+            return true;
+        };
+
+        if ( is_amount ) {
+            for ( size_t pos = 0; pos < amount->entries.size(); ) {
+                const compact::entry entry = compact::read( amount->entries, pos );
+                if ( skip( entry.symcode ) ) continue;
+                if ( !add( asset{ entry.amount, find_symbol( _tokens, row_contract, entry.symcode ) } ) ) return page;
+            }
+            ++amount;
+        } else {
+            for ( const auto& [ code, balance ] : legacy->balances ) {
+                if ( skip( code ) ) continue;
+                if ( !add( balance ) ) return page;
+            }
+            ++legacy;
+        }
+    }
+    return page;
+}
+
+[[eosio::action, eosio::read_only]]
+vector<sx::wallet::stats_row> sx::wallet::getstats( const name contract, const symbol_code symcode )
+{
+    vector<sx::wallet::stats_row> windows;
+    const auto list = [&]( const name contract, const symbol_code symcode ) {
+        sx::wallet::stats _stats( get_self(), balance_key( contract, symcode ) );
+        const size_t first = windows.size();
+        for ( const auto& row : _stats ) windows.push_back( row );
+
+        // ring buffer slots are not in time order
+        std::sort( windows.begin() + first, windows.end(), []( const auto& a, const auto& b ) { return a.window < b.window; });
+    };
+    if ( contract && symcode.raw() ) {
+        list( contract, symcode );
+        return windows;
+    }
+
+    // token contracts & symbols are known from the token cache
+    sx::wallet::tokens _tokens( get_self(), get_self().value );
+    for ( const auto& token : _tokens ) {
+        const extended_symbol sym = token.sym;
+        if ( contract && sym.get_contract() != contract ) continue;
+        if ( symcode.raw() && sym.get_symbol().code() != symcode ) continue;
+        list( sym.get_contract(), sym.get_symbol().code() );
+    }
+    return windows;
+}
+
+[[eosio::action]]
+void sx::wallet::queuemigrate( const vector<name> accounts )
+{
+    require_auth( get_self() );
+
+    sx::wallet::migrations _migrations( get_self(), get_self().value );
+    for ( const name account : accounts ) {
+        if ( _migrations.find( account.value ) != _migrations.end() ) continue;
+        _migrations.emplace( get_self(), [&]( auto& row ) {
+            row.account = account;
+        });
+    }
+}
+
+[[eosio::action]]
+sx::wallet::migrate_result sx::wallet::migrate( const uint32_t max_rows )
+{
+    check( max_rows > 0, "max_rows must be positive" );
+
+    sx::wallet::migrations _migrations( get_self(), get_self().value );
+    uint32_t rows = 0;
+    auto itr = _migrations.begin();
+    while ( itr != _migrations.end() && rows < max_rows ) {
+        const uint32_t budget = max_rows - rows;
+        const uint32_t moved = migrate_account( itr->account, budget );
+        rows += moved;
+
+        // account keeps legacy rows only when the budget ran out
+        if ( moved == budget ) break;
+        itr = _migrations.erase( itr );
+    }
+    return { rows, _migrations.begin() == _migrations.end() };
+}
+
+[[eosio::action]]
+sx::wallet::sweep_result sx::wallet::sweep( const uint32_t max_rows )
+{
+    check( max_rows > 0, "max_rows must be positive" );
+
+    sx::wallet::sweeper _sweeper( get_self(), get_self().value );
+    sx::wallet::sweeper_row cursor = _sweeper.get_or_default();
+    sx::wallet::sweep_result result = { 0, 0, false };
+
+    // every registry row & balance row visited counts against the budget
+    sx::wallet::accounts _accounts( get_self(), get_self().value );
+    uint32_t budget = max_rows;
+    vector<token_stats> counters;
+    while ( true ) {
+        // an account left mid-way is resumed without the registry (its row is erased with the last
+        // registered balance) nor charged again, any budget makes progress
+        const bool resume = cursor.key != 0;
+        if ( !resume ) {
+            if ( budget == 0 ) break;
+            const auto itr = _accounts.lower_bound( cursor.account.value );
+
+            // end of registry, next call starts over
+            if ( itr == _accounts.end() ) {
+                cursor.account = name{};
+                result.done = true;
+                break;
+            }
+            cursor.account = itr->account;
+            budget--;
+        }
+        if ( !sweep_account( cursor, budget, result, counters ) ) break;
+
+        cursor.account = name{ cursor.account.value + 1 };
+        cursor.key = 0;
+    }
+
+    cursor.rows += result.rows;
+    cursor.bytes += result.bytes;
+    _sweeper.set( cursor, get_self() );
+    if constexpr ( policy::stats ) log_stats( counters.data(), counters.size() );
+    return result;
 }
 
 [[eosio::action]]
 void sx::wallet::withdraw( const name account, const name contract, const asset quantity )
 {
     require_auth( account );
+    check( quantity.amount > 0, "quantity must be positive" );
 
     // deduct balance from internal balances
     sub_balance( account, contract, quantity );
+    add_liability( contract, -quantity );
+
+    if constexpr ( policy::stats ) {
+        const token_stats delta = { contract, quantity.symbol.code(), quantity.amount, 0, 1, 0, 0 };
+        log_stats( &delta, 1 );
+    }
 
-    // // (OPTIONAL) account must already have open balance (prevents exploiting RAM)
-    // check_open( account, contract, quantity.symbol.code() );
+    // account must already have open balance in token contract (prevents exploiting RAM)
+    if constexpr ( policy::strict_open ) check_open( account, contract, quantity.symbol.code() );
 
     // return tokens to account
     token::transfer_action transfer( contract, { get_self(), "active"_n });
     transfer.send( get_self(), account, quantity, "withdraw" );
 }
 
+[[eosio::action]]
+void sx::wallet::withdrawbatch( const name account, const vector<extended_asset> quantities )
+{
+    require_auth( account );
+    check( quantities.size(), "quantities cannot be empty" );
+
+    // group quantities by token contract & merge duplicate symbols
+    map<name, map<symbol_code, asset>> withdrawals;
+    for ( const extended_asset& ext : quantities ) {
+        check( ext.quantity.amount > 0, "quantity must be positive" );
+        auto& withdrawal = withdrawals[ ext.contract ];
+        const auto itr = withdrawal.find( ext.quantity.symbol.code() );
+        if ( itr == withdrawal.end() ) withdrawal.emplace( ext.quantity.symbol.code(), ext.quantity );
+        else itr->second += ext.quantity;
+    }
+
+    vector<token_stats> counters;
+    for ( const auto& [ contract, withdrawal ] : withdrawals ) {
+        // deduct balances from internal balances (single row write per symbol)
+        vector<asset> quantities;
+        quantities.reserve( withdrawal.size() );
+        for ( const auto& [ symcode, quantity ] : withdrawal ) quantities.push_back( quantity );
+        sub_balances( account, contract, quantities );
+        for ( const asset& quantity : quantities ) {
+            add_liability( contract, -quantity );
+            if constexpr ( policy::strict_open ) check_open( account, contract, quantity.symbol.code() );
+            if constexpr ( policy::stats ) merge_stats( counters, { contract, quantity.symbol.code(), quantity.amount, 0, 1, 0, 0 } );
+        }
+
+        // return tokens to account
+        token::transfer_action transfer( contract, { get_self(), "active"_n });
+        for ( const asset& quantity : quantities ) {
+            transfer.send( get_self(), account, quantity, "withdraw" );
+        }
+    }
+    if constexpr ( policy::stats ) log_stats( counters.data(), counters.size() );
+}
+
+[[eosio::action]]
+void sx::wallet::qwithdraw( const name account, const name contract, const asset quantity )
+{
+    require_auth( account );
+    check( quantity.amount > 0, "quantity must be positive" );
+
+    // deduct balance now, liabilities are reduced when tokens leave the wallet
+    sub_balance( account, contract, quantity );
+    if constexpr ( policy::strict_open ) check_open( account, contract, quantity.symbol.code() );
+
+    // sum into pending withdrawal
+    sx::wallet::pending _pending( get_self(), account.value );
+    const uint64_t id = balance_key( contract, quantity.symbol.code() );
+    const auto itr = _pending.find( id );
+    if ( itr == _pending.end() ) {
+        _pending.emplace( account, [&]( auto& row ) {
+            row.id = id;
+            row.contract = contract;
+            row.quantity = quantity;
+        });
+    } else {
+        check( itr->contract == contract && itr->quantity.symbol == quantity.symbol, "pending key collision" );
+        _pending.modify( itr, same_payer, [&]( auto& row ) {
+            row.quantity += quantity;
+        });
+    }
+}
+
+[[eosio::action]]
+void sx::wallet::flush( const name account, const uint32_t max )
+{
+    check( max > 0, "max must be positive" );
+
+    // rows of a single account, a failing transfer cannot block other accounts
+    sx::wallet::pending _pending( get_self(), account.value );
+    check( _pending.begin() != _pending.end(), "no pending withdrawals" );
+
+    uint32_t count = 0;
+    for ( auto itr = _pending.begin(); itr != _pending.end() && count < max; count++ ) {
+        add_liability( itr->contract, -itr->quantity );
+
+        // counted as withdrawn once the tokens leave the wallet (rows of an account are distinct tokens)
+        if constexpr ( policy::stats ) {
+            const token_stats delta = { itr->contract, itr->quantity.symbol.code(), itr->quantity.amount, 0, 1, 0, 0 };
+            log_stats( &delta, 1 );
+        }
+
+        token::transfer_action transfer( itr->contract, { get_self(), "active"_n });
+        transfer.send( get_self(), account, itr->quantity, "withdraw" );
+        itr = _pending.erase( itr );
+    }
+}
+
+[[eosio::action]]
+void sx::wallet::qcancel( const name account, const name contract, const symbol_code symcode )
+{
+    require_auth( account );
+
+    sx::wallet::pending _pending( get_self(), account.value );
+    const auto & row = _pending.get( balance_key( contract, symcode ), "no pending withdrawal found" );
+    check( row.contract == contract && row.quantity.symbol.code() == symcode, "pending key collision" );
+
+    // tokens never left the wallet, liabilities are unchanged
+    add_balance( account, contract, row.quantity, account );
+    _pending.erase( row );
+}
+
+[[eosio::action]]
+void sx::wallet::move( const name from, const name to, const name contract, const asset quantity, const string memo )
+{
+    require_auth_or_self( from );
+    check_move( from, to, quantity, memo );
+
+    // sender pays for recipient RAM, unless moved by contract itself (or `self_pays_ram` policy)
+    const name ram_payer = policy::self_pays_ram || !has_auth( from ) ? get_self() : from;
+
+    // internal ledger only (no token transfer)
+    sub_balance( from, contract, quantity );
+    add_balance( to, contract, quantity, ram_payer );
+}
+
+[[eosio::action]]
+void sx::wallet::movemany( const name from, const name contract, const vector<recipient> recipients, const string memo )
+{
+    require_auth_or_self( from );
+    check( recipients.size(), "recipients cannot be empty" );
+
+    // merge debits by symbol
+    map<symbol_code, asset> debits;
+    for ( const recipient& row : recipients ) {
+        check_move( from, row.to, row.quantity, memo );
+        const auto itr = debits.find( row.quantity.symbol.code() );
+        if ( itr == debits.end() ) debits.emplace( row.quantity.symbol.code(), row.quantity );
+        else itr->second += row.quantity;
+    }
+
+    // deduct sender balances (single row write per symbol)
+    vector<asset> quantities;
+    quantities.reserve( debits.size() );
+    for ( const auto& [ symcode, quantity ] : debits ) quantities.push_back( quantity );
+    sub_balances( from, contract, quantities );
+
+    // credit recipients
+    const name ram_payer = policy::self_pays_ram || !has_auth( from ) ? get_self() : from;
+    for ( const recipient& row : recipients ) {
+        add_balance( row.to, contract, row.quantity, ram_payer );
+    }
+}
+
+[[eosio::action]]
+void sx::wallet::settle( const vector<movement> movements )
+{
+    check( movements.size(), "movements cannot be empty" );
+
+    // net legs per account, token contract & symbol, each sender authorized & each token validated once
+    set<name> senders;
+    map<uint64_t, symbol> symbols;
+    map<pair<name, name>, map<symbol_code, balance_delta>> deltas;
+    for ( const movement& leg : movements ) {
+        check_move( leg.from, leg.to, leg.quantity, "" );
+        if ( senders.insert( leg.from ).second ) require_auth_or_self( leg.from );
+
+        const symbol_code symcode = leg.quantity.symbol.code();
+        const uint64_t id = balance_key( leg.contract, symcode );
+        auto sym = symbols.find( id );
+        if ( sym == symbols.end() ) sym = symbols.emplace( id, get_token_symbol( leg.contract, symcode, get_self(), leg.quantity.symbol ) ).first;
+        check( sym->second == leg.quantity.symbol, "symbol precision mismatch" );
+
+        // a balance is billed to the sender of the first leg touching it (a sender may still net positive)
+        const asset zero = asset{ 0, leg.quantity.symbol };
+        const name ram_payer = policy::self_pays_ram || !has_auth( leg.from ) ? get_self() : leg.from;
+        deltas[{ leg.from, leg.contract }].try_emplace( symcode, balance_delta{ zero, ram_payer } ).first->second.quantity -= leg.quantity;
+        deltas[{ leg.to, leg.contract }].try_emplace( symcode, balance_delta{ zero, ram_payer } ).first->second.quantity += leg.quantity;
+    }
+
+    // apply net changes, one `amounts` table per account & at most one write per (account, token contract) row
+    optional<sx::wallet::amounts> _amounts;
+    for ( const auto& [ key, changes ] : deltas ) {
+        const name account = key.first;
+        const name contract = key.second;
+        const bool changed = std::any_of( changes.begin(), changes.end(), []( const auto& change ) { return change.second.quantity.amount != 0; });
+        if ( !changed ) continue;
+        if ( !_amounts || _amounts->get_scope() != account.value ) _amounts.emplace( get_self(), account.value );
+        const auto itr = find_amounts( *_amounts, account, contract );
+
+        // net changes are applied to a copy of the entries, registry rows are billed to the first leg creating a balance
+        vector<char> entries = itr != _amounts->end() ? itr->entries : vector<char>{};
+        uint32_t created = 0;
+        optional<name> ram_payer;
+        for ( const auto& [ symcode, delta ] : changes ) {
+            if ( delta.quantity.amount == 0 ) continue;
+            const compact::entry entry = compact::find( entries, symcode );
+            check( entry.size || delta.quantity.amount > 0, "no balance found" );
+            const asset balance = asset{ entry.amount, delta.quantity.symbol } + delta.quantity;
+            check( balance.amount >= 0, "overdrawn balance" );
+            if ( !entry.size && !created++ ) ram_payer = delta.ram_payer;
+            compact::write( entries, entry, balance.amount );
+        }
+
+        // `amounts` rows are billed to the contract
+        if ( itr == _amounts->end() ) {
+            _amounts->emplace( get_self(), [&]( auto& row ) {
+                row.contract = contract;
+                row.entries = std::move( entries );
+            });
+        } else {
+            const name payer = entries.size() > itr->entries.size() ? get_self() : same_payer;
+            _amounts->modify( itr, payer, [&]( auto& row ) {
+                row.entries = std::move( entries );
+            });
+        }
+        if ( created ) register_balance( account, contract, *ram_payer, created );
+    }
+}
+
 [[eosio::action]]
 void sx::wallet::deposit( const name account, const name contract, const asset quantity )
 {
@@ -50,24 +567,39 @@ void sx::wallet::open( const name account, const name contract, const symbol_cod
 
     check( is_account( account ), "account does not exist" );
 
-    // retrieve token precision directly from token contract
-    const asset supply = token::get_supply( contract, symcode );
-    sx::wallet::balances _balances( get_self(), account.value );
-    const auto itr = _balances.find( contract.value );
+    sx::wallet::amounts _amounts( get_self(), account.value );
+    const auto itr = find_amounts( _amounts, account, contract );
+    const compact::entry entry = itr != _amounts.end() ? compact::find( itr->entries, symcode ) : compact::entry{ 0, 0, symcode, 0 };
 
-    // create new balance entry
-    if ( itr == _balances.end() ) {
-        _balances.emplace( ram_payer, [&]( auto& row ) {
+    // balance already exists, marked as opened so `sweep` keeps it
+    if ( entry.size ) {
+        if ( !entry.opened ) {
+            _amounts.modify( itr, same_payer, [&]( auto& row ) {
+                compact::write( row.entries, entry, entry.amount, true );
+            });
+        }
+        return;
+    }
+
+    // token symbol is kept once in token cache
+    get_token_symbol( contract, symcode, ram_payer );
+
+    // create new balance entry (`amounts` rows are billed to the contract, registry rows to `ram_payer`)
+    if ( itr == _amounts.end() ) {
+        _amounts.emplace( get_self(), [&]( auto& row ) {
             row.contract = contract;
-            row.balances[ symcode ] = asset{0, supply.symbol};
+            compact::write( row.entries, entry, 0, true );
         });
     } else {
-        // balance does not exists
-        if ( itr->balances.find( symcode ) == itr->balances.end() ) {
-            _balances.modify( itr, same_payer, [&]( auto& row ) {
-                row.balances[ symcode ] = asset{0, supply.symbol};
-            });
-        }
+        _amounts.modify( itr, get_self(), [&]( auto& row ) {
+            compact::write( row.entries, entry, 0, true );
+        });
+    }
+    register_balance( account, contract, ram_payer );
+
+    if constexpr ( policy::stats ) {
+        const token_stats delta = { contract, symcode, 0, 0, 0, 1, 0 };
+        log_stats( &delta, 1 );
     }
 }
 
@@ -76,75 +608,327 @@ void sx::wallet::close( const name account, const name contract, const symbol_co
 {
     require_auth_or_self( account );
 
-    sx::wallet::balances _balances( get_self(), account.value );
-    const auto & itr = _balances.get( contract.value, "no account to close" );
-
-    // account exists but no balances exists
-    if ( itr.balances.size() == 0 ) return _balances.erase( itr );
-
-    // symbol exists in balances
-    if ( itr.balances.find( symcode ) != itr.balances.end() ) {
-        const asset balance = itr.balances.at( symcode );
-        check( balance.amount == 0, symcode.to_string() + " balance must equal to 0");
-
-        // only single balance exists, delete entire account table row
-        if ( itr.balances.size() == 1 ) return _balances.erase( itr );
+    sx::wallet::amounts _amounts( get_self(), account.value );
+    const auto itr = find_amounts( _amounts, account, contract );
+    check( itr != _amounts.end(), "no account to close" );
+    const compact::entry entry = compact::find( itr->entries, symcode );
+    check( entry.size, "no account to close" );
+    check_lazy( entry.amount == 0, [&]{ return symcode.to_string() + " balance must equal to 0"; });
 
-        // delete single balance
-        _balances.modify( itr, same_payer, [&]( auto& row ) {
-            row.balances.erase( symcode );
+    // delete single balance, or the row with its last balance
+    if ( entry.size == itr->entries.size() ) _amounts.erase( itr );
+    else {
+        _amounts.modify( itr, same_payer, [&]( auto& row ) {
+            compact::erase( row.entries, entry );
         });
     }
+    unregister_balance( account, contract );
+
+    if constexpr ( policy::stats ) {
+        const token_stats delta = { contract, symcode, 0, 0, 0, 0, 1 };
+        log_stats( &delta, 1 );
+    }
 }
 
 void sx::wallet::sub_balance( const name account, const name contract, const asset quantity )
 {
-    sx::wallet::balances _balances( get_self(), account.value );
+    sx::wallet::amounts _amounts( get_self(), account.value );
     const symbol_code symcode = quantity.symbol.code();
-    const auto & itr = _balances.get( contract.value, "no account balance found" );
-    const asset balance = itr.balances.at( symcode );
+    const auto itr = find_amounts( _amounts, account, contract );
+    check( itr != _amounts.end(), "no account balance found" );
+    const compact::entry entry = compact::find( itr->entries, symcode );
+    check( entry.size, "no balance found" );
 
-    // validation
-    check( balance.symbol.code().raw(), "no balance found" );
-    check( balance.amount >= quantity.amount, "overdrawn balance" );
+    // validation (token cache also detects key collisions)
+    const symbol sym = get_token_symbol( contract, symcode, get_self(), quantity.symbol );
+    check( sym == quantity.symbol, "symbol precision mismatch" );
+    const asset balance = asset{ entry.amount, sym } - quantity;
+    check( balance.amount >= 0, "overdrawn balance" );
 
-    // reduce balance
-    _balances.modify( itr, same_payer, [&]( auto& row ) {
-        row.balances[ symcode ] -= quantity;
+    // reduce balance (encoded amount never grows)
+    _amounts.modify( itr, same_payer, [&]( auto& row ) {
+        compact::write( row.entries, entry, balance.amount );
     });
 }
 
-void sx::wallet::add_balance( const name account, const name contract, const asset quantity, const name ram_payer )
+void sx::wallet::sub_balances( const name account, const name contract, const vector<asset>& quantities )
 {
-    sx::wallet::balances _balances( get_self(), account.value );
+    sx::wallet::amounts _amounts( get_self(), account.value );
+    const auto itr = find_amounts( _amounts, account, contract );
+    check( itr != _amounts.end(), "no account balance found" );
+
+    // validation, callers merge duplicate symbols so the row is written once
+    for ( const asset& quantity : quantities ) {
+        const symbol_code symcode = quantity.symbol.code();
+        const compact::entry entry = compact::find( itr->entries, symcode );
+        check( entry.size, "no balance found" );
+        check( get_token_symbol( contract, symcode, get_self(), quantity.symbol ) == quantity.symbol, "symbol precision mismatch" );
+        check( ( asset{ entry.amount, quantity.symbol } - quantity ).amount >= 0, "overdrawn balance" );
+    }
+
+    // reduce balances (entries move when an encoded amount shrinks, found again after each write)
+    _amounts.modify( itr, same_payer, [&]( auto& row ) {
+        for ( const asset& quantity : quantities ) {
+            const compact::entry entry = compact::find( row.entries, quantity.symbol.code() );
+            compact::write( row.entries, entry, ( asset{ entry.amount, quantity.symbol } - quantity ).amount );
+        }
+    });
+}
+
+bool sx::wallet::add_balance( const name account, const name contract, const asset quantity, const name ram_payer, const bool must_be_open )
+{
+    sx::wallet::amounts _amounts( get_self(), account.value );
     const symbol_code symcode = quantity.symbol.code();
-    const auto itr = _balances.find( contract.value );
+    const auto itr = find_amounts( _amounts, account, contract );
+    const compact::entry entry = itr != _amounts.end() ? compact::find( itr->entries, symcode ) : compact::entry{ 0, 0, symcode, 0 };
+
+    // create new balance entry, amounts are decoded with the token cache (also detects key collisions)
+    if ( !entry.size ) {
+        if ( must_be_open ) check( false, "account must have `open` balance" );
+        get_token_symbol( contract, symcode, ram_payer, quantity.symbol );
+    }
 
-    // create new balance entry
-    if ( itr == _balances.end() ) {
-        _balances.emplace( ram_payer, [&]( auto& row ) {
+    // callers have validated quantity symbol against the token cache, row growth is billed to the contract
+    const asset balance = asset{ entry.amount, quantity.symbol } + quantity;
+    if ( itr == _amounts.end() ) {
+        _amounts.emplace( get_self(), [&]( auto& row ) {
             row.contract = contract;
-            row.balances[ symcode ] = quantity;
+            compact::write( row.entries, entry, balance.amount );
         });
-    // modify existing balance entry
     } else {
-        // create new field
-        if ( !itr->balances.at( symcode ).symbol.code() ) {
-            _balances.modify( itr, ram_payer, [&]( auto& row ) {
-                row.balances[ symcode ] = quantity;
-            });
-        // modify existing field
+        const name payer = compact::entry_size( symcode, balance.amount ) > entry.size ? get_self() : same_payer;
+        _amounts.modify( itr, payer, [&]( auto& row ) {
+            compact::write( row.entries, entry, balance.amount );
+        });
+    }
+    if ( entry.size ) return false;
+    register_balance( account, contract, ram_payer );
+    return true;
+}
+
+optional<sx::wallet::memo_route> sx::wallet::parse_memo( const string_view memo )
+{
+    // <account>[:<tags>], decoded in place without allocating
+    const size_t separator = memo.find( ':' );
+    const string_view account = memo.substr( 0, separator );
+    if ( account.empty() || account.size() > 12 || account.back() == '.' ) return {};
+
+    uint64_t value = 0;
+    for ( size_t i = 0; i < account.size(); i++ ) {
+        const char c = account[i];
+        uint64_t digit = 0;
+        if ( c >= 'a' && c <= 'z' ) digit = c - 'a' + 6;
+        else if ( c >= '1' && c <= '5' ) digit = c - '1' + 1;
+        else if ( c != '.' ) return {};
+        value |= digit << ( 64 - 5 * ( i + 1 ) );
+    }
+    const string_view tags = separator == string_view::npos ? string_view{} : memo.substr( separator + 1 );
+    return memo_route{ name{ value }, tags };
+}
+
+symbol sx::wallet::get_token_symbol( const name contract, const symbol_code symcode, const name ram_payer, const symbol fallback )
+{
+    sx::wallet::tokens _tokens( get_self(), get_self().value );
+    const uint64_t id = balance_key( contract, symcode );
+    const auto itr = _tokens.find( id );
+
+    // cached token
+    if ( itr != _tokens.end() ) {
+        check( itr->sym.get_contract() == contract && itr->sym.get_symbol().code() == symcode, "token key collision" );
+        return itr->sym.get_symbol();
+    }
+
+    // first time seen, retrieve token precision directly from token contract
+    token::stats _stats( contract, symcode.raw() );
+    const auto stat = _stats.find( symcode.raw() );
+    check( stat != _stats.end() || fallback.raw(), "token symbol does not exist" );
+    const symbol sym = stat != _stats.end() ? stat->supply.symbol : fallback;
+
+    _tokens.emplace( ram_payer, [&]( auto& row ) {
+        row.id = id;
+        row.sym = extended_symbol{ sym, contract };
+    });
+    return sym;
+}
+
+void sx::wallet::log_deposit( const name contract, const asset quantity, const uint32_t log_size )
+{
+    sx::wallet::deposits _deposits( get_self(), get_self().value );
+    const block_timestamp block_time = current_block_time();
+    const uint64_t id = block_time.slot % log_size;
+    const auto itr = _deposits.find( id );
+
+    // new ring buffer slot
+    if ( itr == _deposits.end() ) {
+        _deposits.emplace( get_self(), [&]( auto& row ) {
+            row.id = id;
+            row.block_time = block_time;
+            row.deposits.push_back( deposit_summary{ extended_asset{ quantity, contract }, 1 } );
+        });
+        return;
+    }
+
+    _deposits.modify( itr, get_self(), [&]( auto& row ) {
+        // slot wrapped around, overwrite previous block
+        if ( row.block_time != block_time ) {
+            row.block_time = block_time;
+            row.deposits.clear();
+        }
+        // aggregate deposits of the same token
+        for ( auto& summary : row.deposits ) {
+            if ( summary.quantity.contract != contract || summary.quantity.quantity.symbol != quantity.symbol ) continue;
+            summary.quantity.quantity += quantity;
+            summary.count += 1;
+            return;
+        }
+        row.deposits.push_back( deposit_summary{ extended_asset{ quantity, contract }, 1 } );
+    });
+}
+
+void sx::wallet::merge_stats( vector<sx::wallet::token_stats>& tokens, const sx::wallet::token_stats& delta )
+{
+    for ( auto& token : tokens ) {
+        if ( token.contract != delta.contract || token.symcode != delta.symcode ) continue;
+        token.volume += delta.volume;
+        token.deposits += delta.deposits;
+        token.withdrawals += delta.withdrawals;
+        token.created += delta.created;
+        token.erased += delta.erased;
+        return;
+    }
+    tokens.push_back( delta );
+}
+
+void sx::wallet::log_stats( const sx::wallet::token_stats* deltas, const uint32_t size )
+{
+    const uint32_t now = current_time_point().sec_since_epoch();
+    const time_point_sec window{ now - now % policy::stats_window };
+    const uint64_t id = now / policy::stats_window % policy::stats_size;
+
+    // fixed size row per token & window, writes do not grow with the number of active tokens
+    for ( uint32_t i = 0; i < size; i++ ) {
+        const token_stats& delta = deltas[i];
+        sx::wallet::stats _stats( get_self(), balance_key( delta.contract, delta.symcode ) );
+        const auto merge = [&]( auto& row ) {
+            // new ring buffer slot or slot wrapped around, overwrite previous window
+            if ( row.window != window ) row = sx::wallet::stats_row{ id, window, delta.contract, delta.symcode };
+            row.volume += delta.volume;
+            row.deposits += delta.deposits;
+            row.withdrawals += delta.withdrawals;
+            row.created += delta.created;
+            row.erased += delta.erased;
+        };
+        const auto itr = _stats.find( id );
+        if ( itr == _stats.end() ) _stats.emplace( get_self(), merge );
+        else _stats.modify( itr, get_self(), merge );
+    }
+}
+
+uint32_t sx::wallet::migrate_account( const name account, const uint32_t max_rows )
+{
+    sx::wallet::balances _balances( get_self(), account.value );
+    sx::wallet::amounts _amounts( get_self(), account.value );
+
+    // each legacy row is moved with all its balances
+    uint32_t rows = 0;
+    for ( auto itr = _balances.begin(); itr != _balances.end() && rows < max_rows; itr = _balances.begin() ) {
+        take_legacy_row( _amounts, _balances, itr, account );
+        rows++;
+    }
+    return rows;
+}
+
+bool sx::wallet::sweep_account( sx::wallet::sweeper_row& cursor, uint32_t& budget, sx::wallet::sweep_result& result, vector<sx::wallet::token_stats>& counters )
+{
+    const name account = cursor.account;
+
+    // zero entries not opened by the account are erased & unregistered with a single write per row
+    sx::wallet::amounts _amounts( get_self(), account.value );
+    auto row = _amounts.lower_bound( cursor.key );
+    while ( row != _amounts.end() ) {
+        if ( budget == 0 ) {
+            cursor.key = row->contract.value;
+            return false;
+        }
+        budget--;
+
+        vector<compact::entry> zeros;
+        size_t entries = 0;
+        for ( size_t pos = 0; pos < row->entries.size(); entries++ ) {
+            const compact::entry entry = compact::read( row->entries, pos );
+            if ( entry.amount == 0 && !entry.opened ) zeros.push_back( entry );
+        }
+        if ( zeros.empty() ) {
+            row++;
+            continue;
+        }
+        const name contract = row->contract;
+        result.rows += zeros.size();
+        if constexpr ( policy::stats ) {
+            for ( const compact::entry& entry : zeros ) merge_stats( counters, { contract, entry.symcode, 0, 0, 0, 0, 1 } );
+        }
+
+        // erase emptied rows, otherwise only their zero entries (last first, offsets of the others are kept)
+        const uint64_t size = eosio::pack_size( *row );
+        if ( zeros.size() == entries ) {
+            result.bytes += size + row_overhead;
+            row = _amounts.erase( row );
         } else {
-            _balances.modify( itr, same_payer, [&]( auto& row ) {
-                row.balances[ symcode ] += quantity;
+            _amounts.modify( row, same_payer, [&]( auto& r ) {
+                for ( auto entry = zeros.rbegin(); entry != zeros.rend(); entry++ ) compact::erase( r.entries, *entry );
             });
+            result.bytes += size - eosio::pack_size( *row );
+            row++;
         }
+        unregister_balance( account, contract, zeros.size() );
+    }
+    return true;
+}
+
+sx::wallet::amounts::const_iterator sx::wallet::find_amounts( sx::wallet::amounts& _amounts, const name account, const name contract )
+{
+    const auto itr = _amounts.find( contract.value );
+    if ( itr != _amounts.end() ) return itr;
+
+    sx::wallet::balances _balances( get_self(), account.value );
+    const auto legacy = _balances.find( contract.value );
+    if ( legacy == _balances.end() ) return itr;
+    return take_legacy_row( _amounts, _balances, legacy, account );
+}
+
+sx::wallet::amounts::const_iterator sx::wallet::take_legacy_row( sx::wallet::amounts& _amounts, sx::wallet::balances& _balances, const sx::wallet::balances::const_iterator legacy, const name account )
+{
+    const name contract = legacy->contract;
+    check( _amounts.find( contract.value ) == _amounts.end(), "balance exists in multiple layouts" );
+
+    // legacy map is ordered by symbol code like the compact entries, every symbol is cached to decode them;
+    // legacy balances do not tell `open` & deposits apart, all of them are kept by `sweep`
+    size_t size = 0;
+    for ( const auto& [ symcode, balance ] : legacy->balances ) size += compact::entry_size( symcode, balance.amount );
+    vector<char> entries;
+    entries.reserve( size );
+    for ( const auto& [ symcode, balance ] : legacy->balances ) {
+        check( get_token_symbol( contract, symcode, get_self(), balance.symbol ) == balance.symbol, "symbol precision mismatch" );
+        compact::write( entries, { entries.size(), 0, symcode, 0 }, balance.amount, true );
+
+        // legacy balances were deposited before liabilities were tracked
+        if ( balance.amount ) add_liability( contract, balance );
     }
+    const uint32_t count = legacy->balances.size();
+    _balances.erase( legacy );
+
+    // clean up empty legacy rows
+    if ( count == 0 ) return _amounts.end();
+    register_balance( account, contract, get_self(), count );
+    return _amounts.emplace( get_self(), [&]( auto& row ) {
+        row.contract = contract;
+        row.entries = std::move( entries );
+    });
 }
 
 void sx::wallet::check_open( const name account, const name contract, const symbol_code symcode )
 {
-    check( is_account( account ), account.to_string() + " account does not exist");
+    check_lazy( is_account( account ), [&]{ return account.to_string() + " account does not exist"; });
 
     // disable checks if authority is self
     if ( has_auth( get_self() )) return;
@@ -152,23 +936,79 @@ void sx::wallet::check_open( const name account, const name contract, const symb
     // make sure receiver has open balance
     token::accounts _accounts( contract, account.value );
     auto itr = _accounts.find( symcode.raw() );
-    check( itr != _accounts.end(), account.to_string() + " account must have " + symcode.to_string() + " `open` balance in " + contract.to_string());
+    check_lazy( itr != _accounts.end(), [&]{ return account.to_string() + " account must have " + symcode.to_string() + " `open` balance in " + contract.to_string(); });
 }
 
-void sx::wallet::check_open_internal( const name account, const name contract, const symbol_code symcode )
+void sx::wallet::add_liability( const name contract, const asset quantity )
 {
-    check( is_account( account ), account.to_string() + " account does not exist");
+    sx::wallet::liabilities _liabilities( get_self(), get_self().value );
+    const uint64_t id = balance_key( contract, quantity.symbol.code() );
+    const auto itr = _liabilities.find( id );
 
-    // disable checks if authority is self
-    if ( has_auth( get_self() )) return;
+    // legacy balances are only counted once moved, `solvency` waits for `setliability` to mark the token seeded
+    if ( itr == _liabilities.end() ) {
+        _liabilities.emplace( get_self(), [&]( auto& row ) {
+            row.id = id;
+            row.contract = contract;
+            row.supply = quantity;
+            row.seeded = false;
+        });
+    } else {
+        check( itr->supply.symbol == quantity.symbol, "liabilities symbol mismatch" );
+        _liabilities.modify( itr, same_payer, [&]( auto& row ) {
+            row.supply += quantity;
+        });
+    }
+}
 
-    // make sure receiver has open balance internally
-    sx::wallet::balances _balances( get_self(), account.value );
-    const string message = account.to_string() + " account must have " + symcode.to_string() + " `open` balance in " + get_self().to_string();
-    const auto itr = _balances.find( contract.value );
-    check( itr != _balances.end(), message );
-    const asset balance = itr->balances.at( symcode );
-    check( balance.symbol.code().raw(), message );
+void sx::wallet::register_balance( const name account, const name contract, const name ram_payer, const uint32_t count )
+{
+    // token contract holders
+    sx::wallet::holders _holders( get_self(), contract.value );
+    const auto holder = _holders.find( account.value );
+    if ( holder == _holders.end() ) {
+        _holders.emplace( ram_payer, [&]( auto& row ) {
+            row.account = account;
+            row.balances = count;
+        });
+    } else {
+        _holders.modify( holder, same_payer, [&]( auto& row ) {
+            row.balances += count;
+        });
+    }
+
+    // account registry
+    sx::wallet::accounts _accounts( get_self(), get_self().value );
+    const auto itr = _accounts.find( account.value );
+    if ( itr == _accounts.end() ) {
+        _accounts.emplace( ram_payer, [&]( auto& row ) {
+            row.account = account;
+            row.first_seen = current_time_point();
+            row.balances = count;
+        });
+    } else {
+        _accounts.modify( itr, same_payer, [&]( auto& row ) {
+            row.balances += count;
+        });
+    }
+}
+
+void sx::wallet::unregister_balance( const name account, const name contract, const uint32_t count )
+{
+    // balances opened before the registry existed are not counted
+    sx::wallet::holders _holders( get_self(), contract.value );
+    const auto holder = _holders.find( account.value );
+    if ( holder != _holders.end() ) {
+        if ( holder->balances <= count ) _holders.erase( holder );
+        else _holders.modify( holder, same_payer, [&]( auto& row ) { row.balances -= count; });
+    }
+
+    sx::wallet::accounts _accounts( get_self(), get_self().value );
+    const auto itr = _accounts.find( account.value );
+    if ( itr != _accounts.end() ) {
+        if ( itr->balances <= count ) _accounts.erase( itr );
+        else _accounts.modify( itr, same_payer, [&]( auto& row ) { row.balances -= count; });
+    }
 }
 
 void sx::wallet::require_auth_or_self( const name account )
@@ -176,3 +1016,12 @@ void sx::wallet::require_auth_or_self( const name account )
     if ( has_auth( get_self() ) ) return;
     require_auth( account );
 }
+
+void sx::wallet::check_move( const name from, const name to, const asset quantity, const string& memo )
+{
+    check( from != to, "cannot move to self" );
+    check( is_account( to ), "to account does not exist" );
+    check( quantity.is_valid(), "invalid quantity" );
+    check( quantity.amount > 0, "must move positive quantity" );
+    check( memo.size() <= 256, "memo has more than 256 bytes" );
+}
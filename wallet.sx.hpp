@@ -1,50 +1,954 @@
 #include <eosio/eosio.hpp>
 #include <eosio/asset.hpp>
+#include <eosio/crypto.hpp>
+#include <eosio/singleton.hpp>
+#include <eosio.token/eosio.token.hpp>
 
 using namespace eosio;
 using namespace std;
 
+#include <algorithm>
 #include <optional>
+#include <string_view>
+
+// compile-time policies, override with -D flags (see `scripts/build.sh`)
+#ifndef WALLET_STRICT_OPEN
+#define WALLET_STRICT_OPEN 0
+#endif
+#ifndef WALLET_NOTIFY
+#define WALLET_NOTIFY 1
+#endif
+#ifndef WALLET_SELF_PAYS_RAM
+#define WALLET_SELF_PAYS_RAM 0
+#endif
+#ifndef WALLET_STATS
+#define WALLET_STATS 0
+#endif
+#ifndef WALLET_STATS_WINDOW
+#define WALLET_STATS_WINDOW 3600
+#endif
+#ifndef WALLET_STATS_SIZE
+#define WALLET_STATS_SIZE 168
+#endif
 
 namespace sx {
 
+namespace policy {
+    // deposits require an `open` wallet balance & withdrawals an `open` token balance
+    static constexpr bool strict_open = WALLET_STRICT_OPEN;
+
+    // deposit notifications (`settings.notify`), disabled skips the settings read on every deposit
+    static constexpr bool notify = WALLET_NOTIFY;
+
+    // contract pays registry RAM of balances created by `move`, `movemany` & `settle` (instead of sender)
+    static constexpr bool self_pays_ram = WALLET_SELF_PAYS_RAM;
+
+    // per-token operation counters in the `stats` ring buffer (`stats_size` windows of `stats_window` seconds)
+    static constexpr bool stats = WALLET_STATS;
+    static constexpr uint32_t stats_window = WALLET_STATS_WINDOW;
+    static constexpr uint32_t stats_size = WALLET_STATS_SIZE;
+    static_assert( stats_window > 0 && stats_size > 0, "stats window & size must be positive" );
+}
+
+// balance entries of an `amounts` row: varuint symbol code followed by varuint amount, ordered by symbol code
+namespace compact {
+    // entry of a symbol code within the encoded entries (`size` is 0 when not found, `offset` is then its insert position)
+    struct entry {
+        size_t          offset;
+        size_t          size;
+        symbol_code     symcode;
+        int64_t         amount;
+        bool            opened;
+    };
+
+    inline size_t varuint_size( uint64_t value )
+    {
+        size_t size = 1;
+        for ( ; value >= 0x80; value >>= 7 ) size++;
+        return size;
+    }
+
+    inline uint64_t read_varuint( const vector<char>& data, size_t& pos )
+    {
+        uint64_t value = 0;
+        for ( int shift = 0; shift < 64; shift += 7 ) {
+            check( pos < data.size(), "invalid compact balance" );
+            const uint8_t byte = data[pos++];
+            value |= uint64_t( byte & 0x7f ) << shift;
+            if ( !( byte & 0x80 ) ) return value;
+        }
+        check( false, "invalid compact balance" );
+        return 0;
+    }
+
+    inline char* write_varuint( char* out, uint64_t value )
+    {
+        for ( ; value >= 0x80; value >>= 7 ) *out++ = char( value | 0x80 );
+        *out++ = char( value );
+        return out;
+    }
+
+    // amounts are stored shifted left by one, the low bit is the `opened` flag (same encoded size either way)
+    inline uint64_t pack_amount( const int64_t amount, const bool opened )
+    {
+        return static_cast<uint64_t>( amount ) << 1 | opened;
+    }
+
+    // bytes of an entry once written
+    inline size_t entry_size( const symbol_code symcode, const int64_t amount )
+    {
+        return varuint_size( symcode.raw() ) + varuint_size( pack_amount( amount, false ) );
+    }
+
+    // decode the entry at `pos` and advance to the next one
+    inline entry read( const vector<char>& data, size_t& pos )
+    {
+        const size_t offset = pos;
+        const symbol_code symcode{ read_varuint( data, pos ) };
+        const uint64_t value = read_varuint( data, pos );
+        return { offset, pos - offset, symcode, static_cast<int64_t>( value >> 1 ), bool( value & 1 ) };
+    }
+
+    // scan up to `symcode`, amounts of the entries before it are skipped without being decoded
+    inline entry find( const vector<char>& data, const symbol_code symcode )
+    {
+        size_t pos = 0;
+        while ( pos < data.size() ) {
+            const size_t offset = pos;
+            const uint64_t code = read_varuint( data, pos );
+            if ( code > symcode.raw() ) return { offset, 0, symcode, 0 };
+            if ( code == symcode.raw() ) {
+                const uint64_t value = read_varuint( data, pos );
+                return { offset, pos - offset, symcode, static_cast<int64_t>( value >> 1 ), bool( value & 1 ) };
+            }
+            while ( pos < data.size() && data[pos] & 0x80 ) pos++;
+            pos++;
+        }
+        return { data.size(), 0, symcode, 0 };
+    }
+
+    // overwrite (or insert) the entry returned by `find`, bytes are only moved when the encoded size changes
+    inline void write( vector<char>& data, const entry& at, const int64_t amount, const bool opened )
+    {
+        const size_t size = entry_size( at.symcode, amount );
+        if ( size > at.size ) data.insert( data.begin() + at.offset, size - at.size, 0 );
+        if ( size < at.size ) data.erase( data.begin() + at.offset, data.begin() + at.offset + at.size - size );
+        write_varuint( write_varuint( data.data() + at.offset, at.symcode.raw() ), pack_amount( amount, opened ) );
+    }
+
+    // update the amount of an entry, keeping its `opened` flag
+    inline void write( vector<char>& data, const entry& at, const int64_t amount )
+    {
+        write( data, at, amount, at.opened );
+    }
+
+    inline void erase( vector<char>& data, const entry& at )
+    {
+        data.erase( data.begin() + at.offset, data.begin() + at.offset + at.size );
+    }
+}
+
 class [[eosio::contract("wallet.sx")]] wallet : public contract {
 
 public:
     using contract::contract;
 
     /**
-     * ## TABLE `balances`
+     * ## TABLE `amounts`
+     *
+     * **scope:** `account`
+     *
+     * Compact balances, one row per token contract holding every symbol of the account.
+     * Each balance is stored as a varuint symbol code followed by a varuint amount, ordered by symbol code; the precision
+     * is kept once in the `tokens` cache, so a symbol is never repeated. Reading or updating a balance scans the entries
+     * up to its symbol and only decodes its amount.
+     *
+     * The low bit of the amount marks balances created by `open` (and moved from legacy `balances`), they are kept
+     * by `sweep` while zero.
+     *
+     * Rows are billed to wallet.sx: every symbol of the token contract shares the row and an entry grows with its
+     * amount, so no single account could be billed for it without re-billing the others. `ram_payer` of `open`, `move`
+     * & `settle` pays for the registry rows (`accounts` & `holders`) of the balances it creates.
+     *
+     * - `{name} contract` - token contract
+     * - `{bytes} entries` - balances (`varuint` symbol code, `varuint` amount in units of the token precision `<< 1 | opened`)
+     *
+     * ### Example - cleos
+     *
+     * ```bash
+     * $ cleos get table wallet.sx myaccount amounts
+     * ```
+     *
+     * ### Example - json
+     *
+     * ```json
+     * {
+     *     "contract": "eosio.token",
+     *     "entries": "c59ecd02a09c01"
+     * }
+     * ```
+     */
+    struct [[eosio::table("amounts")]] amounts_row {
+        name                            contract;
+        vector<char>                    entries;
+
+        uint64_t primary_key() const { return contract.value; }
+    };
+    typedef eosio::multi_index< "amounts"_n, amounts_row > amounts;
+
+    /**
+     * ## TABLE `balances` (legacy)
+     *
+     * **scope:** `account`
+     *
+     * Previous layout, one row per token contract holding a map of all its symbols.
+     * Rows are moved into `amounts` with all their symbols the first time one of them is touched (or by `migrate`)
+     * and are no longer written to.
+     *
+     * - `{name} contract` - token contract
+     * - `{map<symbol_code, asset>} balances` - balances
+     *
+     * ### Example - cleos
+     *
+     * ```bash
+     * $ cleos get table wallet.sx myaccount balances
+     * ```
+     *
+     * ### Example - json
+     *
+     * ```json
+     * {
+     *     "contract": "eosio.token",
+     *     "balances": [
+     *         { "key": "EOS", "value": "1.0000 EOS" }
+     *     ]
+     * }
+     * ```
+     */
+    struct [[eosio::table("balances")]] balances_row {
+        name                            contract;
+        map<symbol_code, asset>         balances;
+
+        uint64_t primary_key() const { return contract.value; }
+    };
+    typedef eosio::multi_index< "balances"_n, balances_row > balances;
+
+    /**
+     * ## TABLE `tokens`
+     *
+     * **scope:** `get_self()`
+     *
+     * Token symbol cache, filled the first time a token is opened or deposited.
+     * Also holds the precision of the token's `amounts` entries; an evicted token is
+     * re-read from the token contract `stat` table on next use.
+     *
+     * - `{uint64_t} id` - token key (see `balance_key`)
+     * - `{extended_symbol} sym` - token contract & symbol (with precision)
+     *
+     * ### Example - cleos
+     *
+     * ```bash
+     * $ cleos get table wallet.sx wallet.sx tokens
+     * ```
+     *
+     * ### Example - json
+     *
+     * ```json
+     * {
+     *     "id": "13979398101738385213",
+     *     "sym": { "contract": "eosio.token", "sym": "4,EOS" }
+     * }
+     * ```
+     */
+    struct [[eosio::table("tokens")]] tokens_row {
+        uint64_t                        id;
+        extended_symbol                 sym;
+
+        uint64_t primary_key() const { return id; }
+    };
+    typedef eosio::multi_index< "tokens"_n, tokens_row > tokens;
+
+    /**
+     * ## TABLE `settings`
+     *
+     * - `{name} notify` - deposit notification mode
+     *   - `inline` - inline `deposit` action per incoming transfer (default)
+     *   - `none` - no deposit notification
+     *   - `aggregated` - per-block deposit totals written to `deposits` ring buffer
+     * - `{uint32_t} log_size` - maximum number of `deposits` rows (ring buffer size)
+     *
+     * ### Example - cleos
+     *
+     * ```bash
+     * $ cleos get table wallet.sx wallet.sx settings
+     * ```
+     *
+     * ### Example - json
+     *
+     * ```json
+     * {
+     *     "notify": "aggregated",
+     *     "log_size": 1000
+     * }
+     * ```
+     */
+    struct [[eosio::table("settings")]] params {
+        name                            notify = "inline"_n;
+        uint32_t                        log_size = 1000;
+    };
+    typedef eosio::singleton< "settings"_n, params > settings;
+
+    struct deposit_summary {
+        extended_asset                  quantity;
+        uint64_t                        count;
+    };
+
+    /**
+     * ## TABLE `deposits`
+     *
+     * **scope:** `get_self()`
+     *
+     * Per-block deposit totals (`aggregated` notify mode), ring buffer of `log_size` rows.
+     * Slots are reused once the block slot wraps around, order rows by `block_time`.
+     *
+     * - `{uint64_t} id` - ring buffer slot (block timestamp slot % `log_size`)
+     * - `{block_timestamp} block_time` - block of the deposits
+     * - `{vector<deposit_summary>} deposits` - total quantity & number of deposits per token
+     *
+     * ### Example - cleos
+     *
+     * ```bash
+     * $ cleos get table wallet.sx wallet.sx deposits
+     * ```
+     *
+     * ### Example - json
+     *
+     * ```json
+     * {
+     *     "id": 428,
+     *     "block_time": "2020-09-13T12:26:40.000",
+     *     "deposits": [
+     *         { "quantity": { "contract": "eosio.token", "quantity": "12.0000 EOS" }, "count": 3 }
+     *     ]
+     * }
+     * ```
+     */
+    struct [[eosio::table("deposits")]] deposits_row {
+        uint64_t                        id;
+        block_timestamp                 block_time;
+        vector<deposit_summary>         deposits;
+
+        uint64_t primary_key() const { return id; }
+    };
+    typedef eosio::multi_index< "deposits"_n, deposits_row > deposits;
+
+    /**
+     * ## TABLE `stats`
+     *
+     * **scope:** token key (see `balance_key`)
+     *
+     * Operation counters of a token contract & symbol code (`stats` policy, `-DWALLET_STATS=1`), one row per time window
+     * of `WALLET_STATS_WINDOW` seconds (default 1 hour) in a ring buffer of `WALLET_STATS_SIZE` rows (default 168, one week).
+     * Slots are reused once the window wraps around, order rows by `window`. Each action writes a token's row once.
+     *
+     * - `{uint64_t} id` - ring buffer slot (window number % `WALLET_STATS_SIZE`)
+     * - `{time_point_sec} window` - start of the window
+     * - `{name} contract` - token contract
+     * - `{symbol_code} symcode` - symbol code
+     * - `{int64_t} volume` - deposited & withdrawn amount, in units of the token precision
+     * - `{uint64_t} deposits` - incoming transfers
+     * - `{uint64_t} withdrawals` - withdrawn balances (`withdraw`, `withdrawbatch` & queued withdrawals sent by `flush`)
+     * - `{uint64_t} created` - balance rows created by deposits & `open`
+     * - `{uint64_t} erased` - balance rows erased by `close` & `sweep`
+     *
+     * ### Example - cleos
+     *
+     * ```bash
+     * $ cleos get table wallet.sx 13979398101738385213 stats
+     * ```
+     *
+     * ### Example - json
+     *
+     * ```json
+     * {
+     *     "id": 81,
+     *     "window": "2020-09-13T12:00:00",
+     *     "contract": "eosio.token",
+     *     "symcode": "EOS",
+     *     "volume": 120000,
+     *     "deposits": 3,
+     *     "withdrawals": 1,
+     *     "created": 1,
+     *     "erased": 0
+     * }
+     * ```
+     */
+    struct [[eosio::table("stats")]] stats_row {
+        uint64_t                        id;
+        time_point_sec                  window;
+        name                            contract;
+        symbol_code                     symcode;
+        int64_t                         volume;
+        uint64_t                        deposits;
+        uint64_t                        withdrawals;
+        uint64_t                        created;
+        uint64_t                        erased;
+
+        uint64_t primary_key() const { return id; }
+    };
+    typedef eosio::multi_index< "stats"_n, stats_row > stats;
+
+    /**
+     * ## TABLE `accounts`
+     *
+     * **scope:** `get_self()`
+     *
+     * Registry of accounts holding at least one `amounts` balance, ordered by first deposit or `open`.
+     *
+     * - `{name} account` - account
+     * - `{time_point_sec} first_seen` - time of the first balance
+     * - `{uint32_t} balances` - number of open balances
+     *
+     * ### Example - cleos
+     *
+     * ```bash
+     * $ cleos get table wallet.sx wallet.sx accounts --index 2 --key-type i128
+     * ```
+     *
+     * ### Example - json
+     *
+     * ```json
+     * {
+     *     "account": "myaccount",
+     *     "first_seen": "2020-09-13T12:26:40",
+     *     "balances": 2
+     * }
+     * ```
+     */
+    struct [[eosio::table("accounts")]] accounts_row {
+        name                            account;
+        time_point_sec                  first_seen;
+        uint32_t                        balances;
+
+        uint64_t primary_key() const { return account.value; }
+        uint128_t by_first_seen() const { return static_cast<uint128_t>( first_seen.sec_since_epoch() ) << 64 | account.value; }
+    };
+    typedef eosio::multi_index< "accounts"_n, accounts_row,
+        indexed_by< "byfirstseen"_n, const_mem_fun< accounts_row, uint128_t, &accounts_row::by_first_seen> >
+    > accounts;
+
+    /**
+     * ## TABLE `holders`
+     *
+     * **scope:** `contract`
+     *
+     * Accounts holding at least one balance of a token contract, ordered by account name.
+     *
+     * - `{name} account` - account
+     * - `{uint32_t} balances` - number of open balances of the token contract
+     *
+     * ### Example - cleos
+     *
+     * ```bash
+     * $ cleos get table wallet.sx eosio.token holders
+     * ```
+     *
+     * ### Example - json
+     *
+     * ```json
+     * {
+     *     "account": "myaccount",
+     *     "balances": 1
+     * }
+     * ```
+     */
+    struct [[eosio::table("holders")]] holders_row {
+        name                            account;
+        uint32_t                        balances;
+
+        uint64_t primary_key() const { return account.value; }
+    };
+    typedef eosio::multi_index< "holders"_n, holders_row > holders;
+
+    struct holder {
+        name                            account;
+        uint32_t                        balances;
+    };
+
+    struct holders_page {
+        vector<holder>                  holders;
+        uint128_t                       next;
+    };
+
+    struct portfolio_page {
+        vector<extended_asset>          balances;
+        uint128_t                       next;
+    };
+
+    /**
+     * ## TABLE `migrations`
+     *
+     * **scope:** `get_self()`
+     *
+     * Queue of accounts with legacy `balances` rows left to migrate, consumed in order by `migrate`.
+     *
+     * - `{name} account` - account to migrate
+     *
+     * ### Example - cleos
+     *
+     * ```bash
+     * $ cleos get table wallet.sx wallet.sx migrations
+     * ```
+     *
+     * ### Example - json
+     *
+     * ```json
+     * {
+     *     "account": "myaccount"
+     * }
+     * ```
+     */
+    struct [[eosio::table("migrations")]] migrations_row {
+        name                            account;
+
+        uint64_t primary_key() const { return account.value; }
+    };
+    typedef eosio::multi_index< "migrations"_n, migrations_row > migrations;
+
+    struct migrate_result {
+        uint32_t                        rows;
+        bool                            done;
+    };
+
+    /**
+     * ## TABLE `sweeper`
+     *
+     * **scope:** `get_self()`
+     *
+     * Progress of `sweep` through the account registry, starts over once the last account was swept.
+     *
+     * - `{name} account` - next account to sweep (empty to start from the first account)
+     * - `{uint64_t} key` - next token contract of `account` (0 when not started)
+     * - `{uint64_t} rows` - total balances erased
+     * - `{uint64_t} bytes` - total RAM reclaimed (bytes)
+     *
+     * ### Example - cleos
+     *
+     * ```bash
+     * $ cleos get table wallet.sx wallet.sx sweeper
+     * ```
+     *
+     * ### Example - json
+     *
+     * ```json
+     * {
+     *     "account": "toaccount",
+     *     "key": 0,
+     *     "rows": 120,
+     *     "bytes": 15360
+     * }
+     * ```
+     */
+    struct [[eosio::table("sweeper")]] sweeper_row {
+        name                            account;
+        uint64_t                        key;
+        uint64_t                        rows;
+        uint64_t                        bytes;
+    };
+    typedef eosio::singleton< "sweeper"_n, sweeper_row > sweeper;
+
+    struct sweep_result {
+        uint32_t                        rows;
+        uint64_t                        bytes;
+        bool                            done;
+    };
+
+    /**
+     * ## TABLE `pending`
+     *
+     * **scope:** `account`
+     *
+     * Queued withdrawals of an account (see `qwithdraw`), one row per token contract & symbol, summed until `flush`.
+     *
+     * - `{uint64_t} id` - balance key (see `balance_key`)
+     * - `{name} contract` - token contract
+     * - `{asset} quantity` - total queued quantity
+     *
+     * ### Example - cleos
+     *
+     * ```bash
+     * $ cleos get table wallet.sx myaccount pending
+     * ```
+     *
+     * ### Example - json
+     *
+     * ```json
+     * {
+     *     "id": "13979398101738385213",
+     *     "contract": "eosio.token",
+     *     "quantity": "3.0000 EOS"
+     * }
+     * ```
+     */
+    struct [[eosio::table("pending")]] pending_row {
+        uint64_t                        id;
+        name                            contract;
+        asset                           quantity;
+
+        uint64_t primary_key() const { return id; }
+    };
+    typedef eosio::multi_index< "pending"_n, pending_row > pending;
+
+    /**
+     * ## TABLE `liabilities`
+     *
+     * **scope:** `get_self()`
+     *
+     * Total of all account balances per token contract & symbol, updated by deposits & withdrawals
+     * (internal moves do not change it, queued withdrawals count until flushed).
+     * Legacy `balances` are added when they are moved into `amounts` (first use or `migrate`), the total is
+     * complete once no legacy balance of the token is left and the token is marked `seeded` (see `setliability`).
+     *
+     * - `{uint64_t} id` - token key (see `balance_key`)
+     * - `{name} contract` - token contract
+     * - `{asset} supply` - sum of account balances owed by the wallet
+     * - `{bool} seeded` - no legacy balance is left out of `supply`, required by `solvency`
+     *
+     * ### Example - cleos
+     *
+     * ```bash
+     * $ cleos get table wallet.sx wallet.sx liabilities
+     * ```
+     *
+     * ### Example - json
+     *
+     * ```json
+     * {
+     *     "id": "13979398101738385213",
+     *     "contract": "eosio.token",
+     *     "supply": "1250.0000 EOS",
+     *     "seeded": true
+     * }
+     * ```
+     */
+    struct [[eosio::table("liabilities")]] liabilities_row {
+        uint64_t                        id;
+        name                            contract;
+        asset                           supply;
+        bool                            seeded;
+
+        uint64_t primary_key() const { return id; }
+    };
+    typedef eosio::multi_index< "liabilities"_n, liabilities_row > liabilities;
+
+    struct solvency_result {
+        asset                           liabilities;
+        asset                           holdings;
+        bool                            solvent;
+    };
+
+    /**
+     * ## ACTION `setsettings`
+     *
+     * Set contract settings (erases settings if empty)
+     *
+     * - **authority**: `get_self()`
+     *
+     * ### params
+     *
+     * - `{params} settings` - settings
+     *
+     * ### Example - cleos
+     *
+     * ```bash
+     * cleos push action wallet.sx setsettings '[{"notify": "none", "log_size": 1000}]' -p wallet.sx
+     * ```
+     */
+    [[eosio::action]]
+    void setsettings( const optional<sx::wallet::params> settings );
+
+    /**
+     * ## ACTION `refreshtoken`
+     *
+     * Refresh cached token symbol from token contract `stat` table
+     *
+     * - **authority**: `get_self()`
+     *
+     * ### params
+     *
+     * - `{name} contract` - token contract (ex: "eosio.token")
+     * - `{symbol_code} symcode` - symbol code (ex: "EOS")
+     *
+     * ### Example - cleos
+     *
+     * ```bash
+     * cleos push action wallet.sx refreshtoken '["eosio.token", "EOS"]' -p wallet.sx
+     * ```
+     */
+    [[eosio::action]]
+    void refreshtoken( const name contract, const symbol_code symcode );
+
+    /**
+     * ## ACTION `evicttoken`
+     *
+     * Evict token from cache (next open or deposit reads the token contract again)
+     *
+     * `amounts` balances of an evicted token are decoded with the precision of the token contract `stat` table
+     * until the token is cached again, tokens without a `stat` row cannot be evicted.
+     *
+     * - **authority**: `get_self()`
+     *
+     * ### params
+     *
+     * - `{name} contract` - token contract (ex: "eosio.token")
+     * - `{symbol_code} symcode` - symbol code (ex: "EOS")
+     *
+     * ### Example - cleos
+     *
+     * ```bash
+     * cleos push action wallet.sx evicttoken '["eosio.token", "EOS"]' -p wallet.sx
+     * ```
+     */
+    [[eosio::action]]
+    void evicttoken( const name contract, const symbol_code symcode );
+
+    /**
+     * ## ACTION `setliability`
+     *
+     * Mark token liabilities as seeded once no legacy `balances` of the token are left (see `queuemigrate` & `migrate`)
+     *
+     * Legacy balances are added to liabilities as they are moved, so no total has to be computed off-chain
+     * and seeding does not race live deposits & withdrawals. Tokens first deposited after the upgrade can be seeded right away.
+     *
+     * - **authority**: `get_self()`
+     *
+     * ### params
+     *
+     * - `{name} contract` - token contract (ex: "eosio.token")
+     * - `{symbol_code} symcode` - symbol code (ex: "EOS")
+     *
+     * ### Example - cleos
+     *
+     * ```bash
+     * cleos push action wallet.sx setliability '["eosio.token", "EOS"]' -p wallet.sx
+     * ```
+     */
+    [[eosio::action]]
+    void setliability( const name contract, const symbol_code symcode );
+
+    /**
+     * ## ACTION `solvency`
+     *
+     * Compare token liabilities against wallet token balance (read-only, fails until the token is `seeded`)
+     *
+     * ### params
+     *
+     * - `{name} contract` - token contract (ex: "eosio.token")
+     * - `{symbol_code} symcode` - symbol code (ex: "EOS")
+     *
+     * ### returns
+     *
+     * - `{asset} liabilities` - sum of account balances
+     * - `{asset} holdings` - wallet balance in token contract
+     * - `{bool} solvent` - holdings cover liabilities
+     *
+     * ### Example - cleos
+     *
+     * ```bash
+     * cleos push action wallet.sx solvency '["eosio.token", "EOS"]' --read-only
+     * ```
+     *
+     * ```json
+     * {
+     *     "liabilities": "1250.0000 EOS",
+     *     "holdings": "1250.0000 EOS",
+     *     "solvent": true
+     * }
+     * ```
+     */
+    [[eosio::action, eosio::read_only]]
+    solvency_result solvency( const name contract, const symbol_code symcode );
+
+    /**
+     * ## ACTION `getholders`
+     *
+     * List holders page by page (read-only)
+     *
+     * Without `contract`, all registered accounts are listed by first seen time, otherwise holders of the token contract by account name.
+     * The cursor is a position rather than an account, a page resumes even if its first account left the registry meanwhile.
+     *
+     * ### params
+     *
+     * - `{name} contract` - token contract (ex: "eosio.token") or empty for all accounts
+     * - `{uint128_t} cursor` - `next` of the previous page (0 for first page): `first_seen << 64 | account` for all accounts, account otherwise
+     * - `{uint32_t} limit` - maximum accounts per page (1-1000)
+     *
+     * ### returns
+     *
+     * - `{vector<holder>} holders` - accounts & number of open balances
+     * - `{uint128_t} next` - cursor of the next page (0 when done)
+     *
+     * ### Example - cleos
+     *
+     * ```bash
+     * cleos push action wallet.sx getholders '["", 0, 100]' --read-only
+     * ```
+     *
+     * ```json
+     * {
+     *     "holders": [ { "account": "myaccount", "balances": 1 } ],
+     *     "next": "0x0000c85353840ccd00105e5f00000000"
+     * }
+     * ```
+     */
+    [[eosio::action, eosio::read_only]]
+    holders_page getholders( const name contract, const uint128_t cursor, const uint32_t limit );
+
+    /**
+     * ## ACTION `getportfolio`
+     *
+     * List all balances of an account across token contracts page by page (read-only)
+     *
+     * Balances are ordered by token contract & symbol code over both layouts (`amounts` & legacy `balances`).
+     *
+     * ### params
+     *
+     * - `{name} account` - account
+     * - `{uint128_t} cursor` - `next` of the previous page (0 for first page): `contract << 64 | symcode` of its first balance
+     * - `{uint32_t} limit` - maximum balances per page (1-1000)
+     * - `{name} contract` - only balances of token contract (empty for all)
+     * - `{symbol_code} symcode` - only balances of symbol code (empty for all)
+     *
+     * ### returns
+     *
+     * - `{vector<extended_asset>} balances` - balances
+     * - `{uint128_t} next` - cursor of the next page (0 when done)
+     *
+     * ### Example - cleos
+     *
+     * ```bash
+     * cleos push action wallet.sx getportfolio '["myaccount", 0, 100, "", ""]' --read-only
+     * ```
+     *
+     * ```json
+     * {
+     *     "balances": [ { "quantity": "1.0000 EOS", "contract": "eosio.token" } ],
+     *     "next": 0
+     * }
+     * ```
+     */
+    [[eosio::action, eosio::read_only]]
+    portfolio_page getportfolio( const name account, const uint128_t cursor, const uint32_t limit, const name contract, const symbol_code symcode );
+
+    /**
+     * ## ACTION `getstats`
+     *
+     * List `stats` windows per token, from oldest to newest (read-only, empty unless built with the `stats` policy)
+     *
+     * Without both `contract` & `symcode`, tokens are listed from the token cache (counters of evicted tokens are left out).
+     *
+     * ### params
+     *
+     * - `{name} contract` - only counters of token contract (empty for all)
+     * - `{symbol_code} symcode` - only counters of symbol code (empty for all)
+     *
+     * ### returns
+     *
+     * - `{vector<stats_row>}` - token counters per window
+     *
+     * ### Example - cleos
+     *
+     * ```bash
+     * cleos push action wallet.sx getstats '["eosio.token", "EOS"]' --read-only
+     * ```
+     *
+     * ```json
+     * [
+     *     { "id": 81, "window": "2020-09-13T12:00:00", "contract": "eosio.token", "symcode": "EOS", "volume": 120000, "deposits": 3, "withdrawals": 1, "created": 1, "erased": 0 }
+     * ]
+     * ```
+     */
+    [[eosio::action, eosio::read_only]]
+    vector<stats_row> getstats( const name contract, const symbol_code symcode );
+
+    /**
+     * ## ACTION `queuemigrate`
+     *
+     * Queue accounts holding legacy `balances` rows for migration (scopes are listed off-chain with `cleos get scope`)
+     *
+     * - **authority**: `get_self()`
+     *
+     * ### params
+     *
+     * - `{vector<name>} accounts` - accounts to migrate
+     *
+     * ### Example - cleos
+     *
+     * ```bash
+     * cleos push action wallet.sx queuemigrate '[["myaccount", "toaccount"]]' -p wallet.sx
+     * ```
+     */
+    [[eosio::action]]
+    void queuemigrate( const vector<name> accounts );
+
+    /**
+     * ## ACTION `migrate`
+     *
+     * Move up to `max_rows` legacy `balances` rows of queued accounts into `amounts`, call repeatedly until `done`
+     *
+     * Progress is persisted by the `migrations` queue, an account is dequeued once all its legacy rows are moved.
+     * Balances are read from any layout while the migration is in progress.
+     *
+     * - **authority**: any account
+     *
+     * ### params
+     *
+     * - `{uint32_t} max_rows` - maximum legacy rows to move in this transaction
      *
-     * **scope:** `account`
+     * ### returns
      *
-     * - `{name} contract` - token contract
-     * - `{map<symbol_code, asset>} balances` - balances
+     * - `{uint32_t} rows` - legacy rows moved
+     * - `{bool} done` - migration queue is empty
      *
      * ### Example - cleos
      *
      * ```bash
-     * $ cleos get table wallet.sx myaccount balances
+     * cleos push action wallet.sx migrate '[500]' -p myaccount
      * ```
+     */
+    [[eosio::action]]
+    migrate_result migrate( const uint32_t max_rows );
+
+    /**
+     * ## ACTION `sweep`
      *
-     * ### Example - json
+     * Erase zero balances of registered accounts to reclaim RAM, visiting up to `max_rows` rows, call repeatedly until `done`
      *
-     * ```json
-     * {
-     *     "contract": "eosio.token",
-     *     "balances": [
-     *         { "key": "EOS", "value": "1.0000 EOS" }
-     *     ]
-     * }
+     * Accounts of the registry (`accounts`) are visited in name order from the `sweeper` cursor: zero entries of `amounts`
+     * rows are erased & unregistered with one write per row (erased once empty). Only balances created by deposits, moves &
+     * settlements are swept, balances created by `open` and moved from legacy `balances` are kept.
+     * A swept balance must be `open` again before it can receive memo deposits or internal moves.
+     *
+     * - **authority**: any account
+     *
+     * ### params
+     *
+     * - `{uint32_t} max_rows` - maximum registry & balance rows to visit in this transaction
+     *
+     * ### returns
+     *
+     * - `{uint32_t} rows` - balances erased
+     * - `{uint64_t} bytes` - RAM reclaimed by erased balances (row size + 112 bytes per row)
+     * - `{bool} done` - last account swept, next call starts over from the first account
+     *
+     * ### Example - cleos
+     *
+     * ```bash
+     * cleos push action wallet.sx sweep '[500]' -p myaccount
      * ```
      */
-    struct [[eosio::table("balances")]] balances_row {
-        name                            contract;
-        map<symbol_code, asset>         balances;
-
-        uint64_t primary_key() const { return contract.value; }
-    };
-    typedef eosio::multi_index< "balances"_n, balances_row > balances;
+    [[eosio::action]]
+    sweep_result sweep( const uint32_t max_rows );
 
     /**
      * ## ACTION `withdraw`
@@ -81,11 +985,123 @@ public:
     [[eosio::action]]
     void withdraw( const name account, const name contract, const asset quantity );
 
+    /**
+     * ## ACTION `withdrawbatch`
+     *
+     * Request to withdraw multiple quantities in a single action
+     *
+     * Duplicate quantities are merged, each token contract row is read, validated and written once.
+     *
+     * - **authority**: `account`
+     *
+     * ### params
+     *
+     * - `{name} account` - account of wallet assets
+     * - `{vector<extended_asset>} quantities` - withdraw quantities (ex: [{"contract": "eosio.token", "quantity": "1.0000 EOS"}])
+     *
+     * ### Example - cleos
+     *
+     * ```bash
+     * cleos push action wallet.sx withdrawbatch '["myaccount", [{"contract": "eosio.token", "quantity": "1.0000 EOS"}]]' -p myaccount
+     * ```
+     *
+     * ### Example - smart contract
+     *
+     * ```c++
+     * // input variables
+     * const name account = "myaccount"_n;
+     * const vector<extended_asset> quantities = {
+     *     extended_asset{ asset{ 10000, symbol{"EOS", 4} }, "eosio.token"_n },
+     *     extended_asset{ asset{ 10000, symbol{"USDT", 4} }, "tethertether"_n }
+     * };
+     *
+     * // send transaction
+     * sx::wallet::withdrawbatch_action withdrawbatch( "wallet.sx"_n, { account, "active"_n });
+     * withdrawbatch.send( account, quantities );
+     * ```
+     */
+    [[eosio::action]]
+    void withdrawbatch( const name account, const vector<extended_asset> quantities );
+
+    /**
+     * ## ACTION `qwithdraw`
+     *
+     * Queue a withdraw, balance is debited immediately and tokens are sent by the next `flush`
+     *
+     * Queued withdraws of the same account, token contract & symbol are summed into a single token transfer.
+     *
+     * - **authority**: `account`
+     *
+     * ### params
+     *
+     * - `{name} account` - account of wallet assets
+     * - `{name} contract` - token contract (ex: "eosio.token")
+     * - `{asset} quantity` - withdraw quantity amount (ex: "1.0000 EOS")
+     *
+     * ### Example - cleos
+     *
+     * ```bash
+     * cleos push action wallet.sx qwithdraw '["myaccount", "eosio.token", "1.0000 EOS"]' -p myaccount
+     * ```
+     */
+    [[eosio::action]]
+    void qwithdraw( const name account, const name contract, const asset quantity );
+
+    /**
+     * ## ACTION `flush`
+     *
+     * Send queued withdrawals of an account, one token transfer per token contract & symbol
+     *
+     * Each account is flushed on its own: a transfer that fails (recipient rejects it, token contract fails)
+     * only reverts the flush of its account, which can take the row back with `qcancel`.
+     * Accounts with queued withdrawals are listed with `cleos get scope wallet.sx -t pending`.
+     * Liabilities & `stats` counters are updated as each transfer is sent.
+     *
+     * - **authority**: any account
+     *
+     * ### params
+     *
+     * - `{name} account` - account to send queued withdrawals to
+     * - `{uint32_t} max` - maximum transfers to send
+     *
+     * ### Example - cleos
+     *
+     * ```bash
+     * cleos push action wallet.sx flush '["myaccount", 100]' -p myaccount
+     * ```
+     */
+    [[eosio::action]]
+    void flush( const name account, const uint32_t max );
+
+    /**
+     * ## ACTION `qcancel`
+     *
+     * Cancel a queued withdrawal, the queued quantity is credited back to the account balance
+     *
+     * - **authority**: `account`
+     *
+     * ### params
+     *
+     * - `{name} account` - account of wallet assets
+     * - `{name} contract` - token contract (ex: "eosio.token")
+     * - `{symbol_code} symcode` - symbol code (ex: "EOS")
+     *
+     * ### Example - cleos
+     *
+     * ```bash
+     * cleos push action wallet.sx qcancel '["myaccount", "eosio.token", "EOS"]' -p myaccount
+     * ```
+     */
+    [[eosio::action]]
+    void qcancel( const name account, const name contract, const symbol_code symcode );
+
     /**
      * ## ACTION `open`
      *
      * Open contract & symbol balance for account
      *
+     * An opened balance is kept by `sweep` while zero (opening an existing balance only marks it), `close` erases it.
+     *
      * - **authority**: `ram_payer`
      *
      * ### params
@@ -93,7 +1109,7 @@ public:
      * - `{name} account` - account to open balance
      * - `{name} contract` - token contract (ex: "eosio.token")
      * - `{symbol_code} symcode` - symcode code (ex: "EOS")
-     * - `{name} ram_payer` - authorized account to pay for RAM
+     * - `{name} ram_payer` - authorized account to pay for RAM (registry & token cache rows, see `amounts`)
      *
      * ### Example - cleos
      *
@@ -149,11 +1165,127 @@ public:
     [[eosio::action]]
     void close( const name account, const name contract, const symbol_code symcode );
 
+    /**
+     * ## ACTION `move`
+     *
+     * Move quantity between two internal wallet balances (no token transfer)
+     *
+     * - **authority**: `from` or `get_self()`
+     *
+     * ### params
+     *
+     * - `{name} from` - account to debit
+     * - `{name} to` - account to credit
+     * - `{name} contract` - token contract (ex: "eosio.token")
+     * - `{asset} quantity` - move quantity amount (ex: "1.0000 EOS")
+     * - `{string} memo` - memo
+     *
+     * ### Example - cleos
+     *
+     * ```bash
+     * cleos push action wallet.sx move '["myaccount", "toaccount", "eosio.token", "1.0000 EOS", "my memo"]' -p myaccount
+     * ```
+     *
+     * ### Example - smart contract
+     *
+     * ```c++
+     * // input variables
+     * const name from = "myaccount"_n;
+     * const name to = "toaccount"_n;
+     * const name contract = "eosio.token"_n;
+     * const asset quantity = asset{ 10000, symbol{"EOS", 4} };
+     * const string memo = "my memo";
+     *
+     * // send transaction
+     * sx::wallet::move_action move( "wallet.sx"_n, { from, "active"_n });
+     * move.send( from, to, contract, quantity, memo );
+     * ```
+     */
+    [[eosio::action]]
+    void move( const name from, const name to, const name contract, const asset quantity, const string memo );
+
+    struct recipient {
+        name        to;
+        asset       quantity;
+    };
+
+    /**
+     * ## ACTION `movemany`
+     *
+     * Move quantities from one internal wallet balance to many recipients
+     *
+     * Debits are merged by symbol, each sender balance row is read, validated and written once for all recipients.
+     *
+     * - **authority**: `from` or `get_self()`
+     *
+     * ### params
+     *
+     * - `{name} from` - account to debit
+     * - `{name} contract` - token contract (ex: "eosio.token")
+     * - `{vector<recipient>} recipients` - accounts to credit (ex: [{"to": "toaccount", "quantity": "1.0000 EOS"}])
+     * - `{string} memo` - memo
+     *
+     * ### Example - cleos
+     *
+     * ```bash
+     * cleos push action wallet.sx movemany '["myaccount", "eosio.token", [{"to": "toaccount", "quantity": "1.0000 EOS"}], "payout"]' -p myaccount
+     * ```
+     *
+     * ### Example - smart contract
+     *
+     * ```c++
+     * // input variables
+     * const name from = "myaccount"_n;
+     * const name contract = "eosio.token"_n;
+     * const vector<sx::wallet::recipient> recipients = {
+     *     { "toaccount"_n, asset{ 10000, symbol{"EOS", 4} } },
+     *     { "basic"_n, asset{ 20000, symbol{"EOS", 4} } }
+     * };
+     *
+     * // send transaction
+     * sx::wallet::movemany_action movemany( "wallet.sx"_n, { from, "active"_n });
+     * movemany.send( from, contract, recipients, "payout" );
+     * ```
+     */
+    [[eosio::action]]
+    void movemany( const name from, const name contract, const vector<recipient> recipients, const string memo );
+
+    struct movement {
+        name        from;
+        name        to;
+        name        contract;
+        asset       quantity;
+    };
+
+    /**
+     * ## ACTION `settle`
+     *
+     * Atomically apply many internal movements between accounts across tokens (ex: clearing a batch of trades)
+     *
+     * Legs are netted per account, token contract & symbol in memory, then each (account, token contract) row is read once,
+     * checked against overdraft on its net changes and written at most once; rows netting to zero are not written.
+     * Registry rows of a created balance are billed to the sender of the first leg touching it (as `move`).
+     *
+     * - **authority**: every distinct `from` or `get_self()`
+     *
+     * ### params
+     *
+     * - `{vector<movement>} movements` - legs to apply (ex: [{"from": "myaccount", "to": "toaccount", "contract": "eosio.token", "quantity": "1.0000 EOS"}])
+     *
+     * ### Example - cleos
+     *
+     * ```bash
+     * cleos push action wallet.sx settle '[[{"from": "myaccount", "to": "toaccount", "contract": "eosio.token", "quantity": "1.0000 EOS"}, {"from": "toaccount", "to": "myaccount", "contract": "tethertether", "quantity": "4.0000 USDT"}]]' -p myaccount -p toaccount
+     * ```
+     */
+    [[eosio::action]]
+    void settle( const vector<movement> movements );
+
     [[eosio::action]]
     void deposit( const name account, const name contract, const asset quantity );
 
     [[eosio::on_notify("*::transfer")]]
-    void on_transfer( const name from, const name to, const asset quantity, const string memo );
+    void on_transfer( const name from, const name to, const asset quantity, const string& memo );
 
     /**
      * ## STATIC `get_balance`
@@ -180,26 +1312,222 @@ public:
      */
     static asset get_balance( const name code, const name account, const name contract, const symbol_code symcode )
     {
+        sx::wallet::amounts _amounts( code, account.value );
+        sx::wallet::tokens _tokens( code, code.value );
+        sx::wallet::balances _balances( code, account.value );
+        return find_balance( _amounts, _tokens, _balances, contract, symcode );
+    }
+
+    /**
+     * ## STATIC `get_balances`
+     *
+     * Get multiple balances of account, returned in request order
+     *
+     * Each `amounts`, `tokens` & legacy `balances` row is deserialized at most once per call.
+     *
+     * ### params
+     *
+     * - `{name} code` - SX wallet contract account
+     * - `{name} account` - account name
+     * - `{name} contract` - token contract
+     * - `{vector<symbol_code>} symcodes` - symbol codes
+     *
+     * ### example
+     *
+     * ```c++
+     * const name account = "myaccount"_n;
+     * const name contract = "eosio.token"_n;
+     *
+     * const vector<asset> balances = sx::wallet::get_balances( "wallet.sx"_n, account, contract, { symbol_code{"EOS"}, symbol_code{"USDT"} } );
+     * //=> ["1.0000 EOS", "2.0000 USDT"]
+     * ```
+     */
+    static vector<asset> get_balances( const name code, const name account, const name contract, const vector<symbol_code>& symcodes )
+    {
+        sx::wallet::amounts _amounts( code, account.value );
+        sx::wallet::tokens _tokens( code, code.value );
+        sx::wallet::balances _balances( code, account.value );
+
+        vector<asset> result;
+        result.reserve( symcodes.size() );
+        for ( const symbol_code symcode : symcodes ) {
+            result.push_back( find_balance( _amounts, _tokens, _balances, contract, symcode ) );
+        }
+        return result;
+    }
+
+    /**
+     * ## STATIC `get_balances` (extended)
+     *
+     * Get multiple balances of account across token contracts, returned in request order
+     *
+     * ### params
+     *
+     * - `{name} code` - SX wallet contract account
+     * - `{name} account` - account name
+     * - `{vector<extended_symbol>} symbols` - token contracts & symbols
+     *
+     * ### example
+     *
+     * ```c++
+     * const name account = "myaccount"_n;
+     * const vector<extended_symbol> symbols = {
+     *     extended_symbol{ symbol{"EOS", 4}, "eosio.token"_n },
+     *     extended_symbol{ symbol{"USDT", 4}, "tethertether"_n }
+     * };
+     *
+     * const vector<extended_asset> balances = sx::wallet::get_balances( "wallet.sx"_n, account, symbols );
+     * //=> [{"contract": "eosio.token", "quantity": "1.0000 EOS"}, {"contract": "tethertether", "quantity": "2.0000 USDT"}]
+     * ```
+     */
+    static vector<extended_asset> get_balances( const name code, const name account, const vector<extended_symbol>& symbols )
+    {
+        sx::wallet::amounts _amounts( code, account.value );
+        sx::wallet::tokens _tokens( code, code.value );
         sx::wallet::balances _balances( code, account.value );
-        const auto balances = _balances.get( contract.value, "no account balance found" ).balances;
-        const asset balance = balances.at( symcode );
-        check( balance.symbol.code().raw(), "no balance found" );
 
-        return balance;
+        vector<extended_asset> result;
+        result.reserve( symbols.size() );
+        for ( const extended_symbol& sym : symbols ) {
+            const name contract = sym.get_contract();
+            result.push_back( extended_asset{ find_balance( _amounts, _tokens, _balances, contract, sym.get_symbol().code() ), contract } );
+        }
+        return result;
+    }
+
+    /**
+     * ## STATIC `balance_key`
+     *
+     * Primary key of the `tokens`, `liabilities` & `pending` tables (and `stats` scope) for a token contract & symbol code
+     *
+     * First 64 bits of `sha256( contract, symcode )`; `tokens`, `liabilities` & `pending` rows store both fields so a collision is always detected.
+     *
+     * ### params
+     *
+     * - `{name} contract` - token contract
+     * - `{symbol_code} symcode` - symbol code
+     *
+     * ### example
+     *
+     * ```c++
+     * const uint64_t id = sx::wallet::balance_key( "eosio.token"_n, symbol_code{"EOS"} );
+     * ```
+     */
+    static uint64_t balance_key( const name contract, const symbol_code symcode )
+    {
+        const uint64_t data[2] = { contract.value, symcode.raw() };
+        const auto hash = sha256( reinterpret_cast<const char*>( data ), sizeof( data ) ).extract_as_byte_array();
+
+        uint64_t key = 0;
+        memcpy( &key, hash.data(), sizeof( key ) );
+        return key;
     }
 
     // action wrappers
+    using setsettings_action = eosio::action_wrapper<"setsettings"_n, &sx::wallet::setsettings>;
+    using refreshtoken_action = eosio::action_wrapper<"refreshtoken"_n, &sx::wallet::refreshtoken>;
+    using evicttoken_action = eosio::action_wrapper<"evicttoken"_n, &sx::wallet::evicttoken>;
+    using setliability_action = eosio::action_wrapper<"setliability"_n, &sx::wallet::setliability>;
+    using solvency_action = eosio::action_wrapper<"solvency"_n, &sx::wallet::solvency>;
+    using getholders_action = eosio::action_wrapper<"getholders"_n, &sx::wallet::getholders>;
+    using getportfolio_action = eosio::action_wrapper<"getportfolio"_n, &sx::wallet::getportfolio>;
+    using getstats_action = eosio::action_wrapper<"getstats"_n, &sx::wallet::getstats>;
+    using queuemigrate_action = eosio::action_wrapper<"queuemigrate"_n, &sx::wallet::queuemigrate>;
+    using migrate_action = eosio::action_wrapper<"migrate"_n, &sx::wallet::migrate>;
+    using sweep_action = eosio::action_wrapper<"sweep"_n, &sx::wallet::sweep>;
     using withdraw_action = eosio::action_wrapper<"withdraw"_n, &sx::wallet::withdraw>;
+    using withdrawbatch_action = eosio::action_wrapper<"withdrawbatch"_n, &sx::wallet::withdrawbatch>;
+    using qwithdraw_action = eosio::action_wrapper<"qwithdraw"_n, &sx::wallet::qwithdraw>;
+    using flush_action = eosio::action_wrapper<"flush"_n, &sx::wallet::flush>;
+    using qcancel_action = eosio::action_wrapper<"qcancel"_n, &sx::wallet::qcancel>;
     using deposit_action = eosio::action_wrapper<"deposit"_n, &sx::wallet::deposit>;
+    using move_action = eosio::action_wrapper<"move"_n, &sx::wallet::move>;
+    using movemany_action = eosio::action_wrapper<"movemany"_n, &sx::wallet::movemany>;
+    using settle_action = eosio::action_wrapper<"settle"_n, &sx::wallet::settle>;
     using open_action = eosio::action_wrapper<"open"_n, &sx::wallet::open>;
     using close_action = eosio::action_wrapper<"close"_n, &sx::wallet::close>;
 
 private:
-    void add_balance( const name account, const name contract, const asset quantity, const name ram_payer );
+    // balance lookup shared by `get_balance` & `get_balances`, rows are cached by the table instances
+    static asset find_balance( const amounts& _amounts, const tokens& _tokens, const balances& _balances, const name contract, const symbol_code symcode )
+    {
+        const auto row = _amounts.find( contract.value );
+        if ( row != _amounts.end() ) {
+            const compact::entry entry = compact::find( row->entries, symcode );
+            check( entry.size, "no balance found" );
+            return asset{ entry.amount, find_symbol( _tokens, contract, symcode ) };
+        }
+
+        // fallback to legacy `balances` layout
+        const auto & legacy = _balances.get( contract.value, "no account balance found" );
+        const auto balance = legacy.balances.find( symcode );
+        check( balance != legacy.balances.end(), "no balance found" );
+
+        return balance->second;
+    }
+
+    // precision of `amounts` entries, evicted tokens are read from the token contract `stat` table
+    static symbol find_symbol( const tokens& _tokens, const name contract, const symbol_code symcode )
+    {
+        const auto cached = _tokens.find( balance_key( contract, symcode ) );
+        if ( cached != _tokens.end() ) {
+            check( cached->sym.get_contract() == contract && cached->sym.get_symbol().code() == symcode, "token key collision" );
+            return cached->sym.get_symbol();
+        }
+        token::stats _stats( contract, symcode.raw() );
+        return _stats.get( symcode.raw(), "token symbol does not exist" ).supply.symbol;
+    }
+
+    // deposit memo `<account>[:<tags>]`, tags are left to off-chain consumers
+    struct memo_route {
+        name            account;
+        string_view     tags;
+    };
+    static optional<memo_route> parse_memo( const string_view memo );
+
+    // returns true when a new balance row was created
+    bool add_balance( const name account, const name contract, const asset quantity, const name ram_payer, const bool must_be_open = false );
     void sub_balance( const name account, const name contract, const asset quantity );
+    void sub_balances( const name account, const name contract, const vector<asset>& quantities );
+    void add_liability( const name contract, const asset quantity );
+    void register_balance( const name account, const name contract, const name ram_payer, const uint32_t count = 1 );
+    void unregister_balance( const name account, const name contract, const uint32_t count = 1 );
+    // assertion whose message is only formatted on failure, keeps the success path free of heap allocations
+    template <typename Message>
+    static void check_lazy( const bool pred, const Message& message )
+    {
+        if ( !pred ) check( false, message() );
+    }
+
     void check_open( const name account, const name contract, const symbol_code symcode );
-    void check_open_internal( const name account, const name contract, const symbol_code symcode );
     void require_auth_or_self( const name account );
+    void check_move( const name from, const name to, const asset quantity, const string& memo );
+    symbol get_token_symbol( const name contract, const symbol_code symcode, const name ram_payer, const symbol fallback = symbol{} );
+    void log_deposit( const name contract, const asset quantity, const uint32_t log_size );
+    // counters of one token, merged per action before the current `stats` window of the token is written
+    struct token_stats {
+        name            contract;
+        symbol_code     symcode;
+        int64_t         volume;
+        uint64_t        deposits;
+        uint64_t        withdrawals;
+        uint64_t        created;
+        uint64_t        erased;
+    };
+    static void merge_stats( vector<token_stats>& tokens, const token_stats& delta );
+    void log_stats( const token_stats* deltas, const uint32_t size );
+    uint32_t migrate_account( const name account, const uint32_t max_rows );
+    bool sweep_account( sweeper_row& cursor, uint32_t& budget, sweep_result& result, vector<token_stats>& counters );
+    // billable RAM of a table row beyond its serialized data (`key_value_object` overhead)
+    static constexpr uint64_t row_overhead = 112;
+    // net change of one balance in `settle`
+    struct balance_delta {
+        asset           quantity;
+        name            ram_payer;
+    };
+    // `amounts` row of a token contract, the legacy `balances` row is moved into it on first use (end if neither exists)
+    amounts::const_iterator find_amounts( amounts& _amounts, const name account, const name contract );
+    amounts::const_iterator take_legacy_row( amounts& _amounts, balances& _balances, const balances::const_iterator legacy, const name account );
 };
 
 }
\ No newline at end of file